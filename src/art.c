@@ -0,0 +1,697 @@
+/* Terminal ScreenSaver - ASCII object loader
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * File format:
+ *
+ *  ESC n / ESC l / ESC r	First two bytes only: no mirror / direction
+ *  ESC 1 .. ESC 8		Color of the following characters
+ *  ESC [ .. m			SGR colors: 30-37, 40-47, 90-97, 100-107,
+ *  				38;5;n / 48;5;n (256 colors),
+ *  				38;2;r;g;b / 48;2;r;g;b (24 bit), 0, 39, 49
+ *  ESC f [ms]			Alone on a line: ends the current frame,
+ *  				which is shown for [ms] milliseconds
+ *
+ * Text is UTF-8; bytes which are not valid UTF-8 are read as Latin-1.
+ * Display widths are looked up once here and never again.
+ *
+ * */
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "art.h"
+#include "utf8.h"
+#include "transform.h"
+#include "share.h"
+#include "tick.h"
+
+#define PALETTE_HASH		1024
+#define SGR_PARAMS		16
+
+struct lineEx{
+  long start;			/* First cell in the scratch buffer */
+  int length;
+  unsigned short end_color;
+};
+
+struct scratchEx{
+  struct cellEx *cell;
+  long cell_count;
+  long cell_size;
+  struct lineEx *line;
+  int line_count;
+  long line_size;
+  int *frame_lines;		/* Line count per frame */
+  int *frame_duration;
+  int frame_count;
+  long frame_size;
+  long palette_size;
+  int *palette_chain;
+  int palette_hash[PALETTE_HASH];
+};
+
+static void *grow(void *ptr, int size, long *allocated, long needed){
+  long n;
+
+  if(needed <= *allocated)
+    return ptr;
+
+  n = *allocated ? *allocated : 64;
+  while(n < needed)
+    n *= 2;
+
+  ptr = realloc(ptr, n * size);
+  if(ptr != NULL)
+    *allocated = n;
+  return ptr;
+}
+
+static int add_cell(struct scratchEx *s, unsigned int ch, unsigned short color){
+  int width;
+
+  width = utf8_width(ch);
+  if(width == 0)
+    return 0;			/* Combining marks are dropped */
+
+  s->cell = grow(s->cell, sizeof(struct cellEx), &s->cell_size, s->cell_count + width);
+  if(s->cell == NULL)
+    return -1;
+  s->cell[s->cell_count].ch = ch;
+  s->cell[s->cell_count].color = color;
+  s->cell[s->cell_count].width = width;
+  s->cell_count++;
+
+  if(width == 2){
+    s->cell[s->cell_count].ch = 0;
+    s->cell[s->cell_count].color = color;
+    s->cell[s->cell_count].width = 0;
+    s->cell_count++;
+  }
+
+  return 0;
+}
+
+static int add_line(struct scratchEx *s, long start, unsigned short color){
+  s->line = grow(s->line, sizeof(struct lineEx), &s->line_size, s->line_count + 1);
+  if(s->line == NULL)
+    return -1;
+  s->line[s->line_count].start = start;
+  s->line[s->line_count].length = s->cell_count - start;
+  s->line[s->line_count].end_color = color;
+  s->line_count++;
+  s->frame_lines[s->frame_count - 1]++;
+  return 0;
+}
+
+static int add_frame(struct scratchEx *s){
+  long size = s->frame_size;
+
+  s->frame_lines = grow(s->frame_lines, sizeof(int), &size, s->frame_count + 1);
+  if(s->frame_lines == NULL)
+    return -1;
+  size = s->frame_size;
+  s->frame_duration = grow(s->frame_duration, sizeof(int), &size, s->frame_count + 1);
+  if(s->frame_duration == NULL)
+    return -1;
+  s->frame_size = size;
+  s->frame_lines[s->frame_count] = 0;
+  s->frame_duration[s->frame_count] = ART_FRAME_DURATION;
+  s->frame_count++;
+  return 0;
+}
+
+/* Palette index of a color combination, added if it is new */
+static int add_color(struct artEx *art, struct scratchEx *s, long fg, long bg){
+  long size;
+  int h;
+  int i;
+
+  if(bg == 0 && fg >= 0 && fg < ART_LEGACY_COLORS)
+    return fg + 1;
+
+  h = (int)(((unsigned long)fg * 31 + (unsigned long)bg * 131) % PALETTE_HASH);
+  for(i = s->palette_hash[h]; i != 0; i = s->palette_chain[i])
+    if(art->palette[i].fg == fg && art->palette[i].bg == bg)
+      return i;
+
+  if(art->palette_count >= ART_MAX_COLORS)
+    return ART_DEFAULT_COLOR;
+
+  size = s->palette_size;
+  art->palette = grow(art->palette, sizeof(struct paletteEx), &size, art->palette_count + 1);
+  if(art->palette == NULL)
+    return -1;
+  size = s->palette_size;
+  s->palette_chain = grow(s->palette_chain, sizeof(int), &size, art->palette_count + 1);
+  if(s->palette_chain == NULL)
+    return -1;
+  s->palette_size = size;
+
+  i = art->palette_count++;
+  art->palette[i].fg = fg;
+  art->palette[i].bg = bg;
+  s->palette_chain[i] = s->palette_hash[h];
+  s->palette_hash[h] = i;
+
+  return i;
+}
+
+/* Apply the SGR parameters between [from] and [to] to [fg] and [bg] */
+static void sgr(char *from, char *to, long *fg, long *bg){
+  long param[SGR_PARAMS];
+  long c;
+  int n;
+  int p;
+
+  n = 0;
+  param[0] = 0;
+  for(; from < to; from++){
+    if(*from == ';'){
+      if(++n == SGR_PARAMS)
+	break;
+      param[n] = 0;
+    }else if(*from >= '0' && *from <= '9' && param[n] < 100000){
+      param[n] = param[n] * 10 + *from - '0';
+    }
+  }
+  if(n < SGR_PARAMS)
+    n++;
+
+  for(p = 0; p < n; p++){
+    if(param[p] == 0){
+      *fg = 7;
+      *bg = 0;
+    }else if(param[p] >= 30 && param[p] <= 37){
+      *fg = param[p] - 30;
+    }else if(param[p] == 39){
+      *fg = 7;
+    }else if(param[p] >= 40 && param[p] <= 47){
+      *bg = param[p] - 40;
+    }else if(param[p] == 49){
+      *bg = 0;
+    }else if(param[p] >= 90 && param[p] <= 97){
+      *fg = param[p] - 90 + 8;
+    }else if(param[p] >= 100 && param[p] <= 107){
+      *bg = param[p] - 100 + 8;
+    }else if((param[p] == 38 || param[p] == 48) && p + 2 < n && param[p + 1] == 5){
+      c = param[p + 2] & 255;
+      if(param[p] == 38) *fg = c; else *bg = c;
+      p += 2;
+    }else if((param[p] == 38 || param[p] == 48) && p + 4 < n && param[p + 1] == 2){
+      c = ART_RGB | (param[p + 2] & 255) << 16 | (param[p + 3] & 255) << 8 | (param[p + 4] & 255);
+      if(param[p] == 38) *fg = c; else *bg = c;
+      p += 4;
+    }
+  }
+}
+
+static void free_scratch(struct scratchEx *s){
+  free(s->palette_chain);
+  free(s->cell);
+  free(s->line);
+  free(s->frame_lines);
+  free(s->frame_duration);
+}
+
+/* Tokenize the whole file once. Colors are resolved per cell here, so
+ * nothing downstream ever has to look at escape codes again. */
+static int scan(struct artEx *art, struct scratchEx *s, char *data, long length){
+  unsigned short color;
+  long fg, bg;
+  long line_start;
+  long end;
+  unsigned int cp;
+  long bol;
+  long i;
+  int first_color;
+  int ms;
+  int c;
+
+  color		= ART_DEFAULT_COLOR;
+  fg		= ART_DEFAULT_COLOR - 1;
+  bg		= 0;
+  first_color	= -1;
+
+  if(add_frame(s) == -1)
+    return -1;
+
+  i = 0;
+  if(length > 2 && data[0] == 27){
+    switch(data[1]){
+    case 'n': art->mirror = 0; i = 2; break;
+    case 'l': art->forced_direction = -1; i = 2; break;
+    case 'r': art->forced_direction = 1; i = 2; break;
+    }
+  }
+
+  line_start = 0;
+  bol = i;
+  for(; i < length; i++){
+    if(data[i] == 27 && i + 1 < length){
+      if(i == bol && data[i + 1] == 'f'){
+	/* Frame marker */
+	ms = 0;
+	for(i += 2; i < length && data[i] != '\n'; i++)
+	  if(data[i] >= '0' && data[i] <= '9' && ms < 3600000)
+	    ms = ms * 10 + data[i] - '0';
+	if(ms > 0)
+	  s->frame_duration[s->frame_count - 1] = ms;
+	if(s->frame_lines[s->frame_count - 1] > 0)
+	  if(add_frame(s) == -1)
+	    return -1;
+	bol = i + 1;
+	continue;
+      }
+      if(data[i + 1] == '['){
+	/* SGR, up to its final byte */
+	for(end = i + 2; end < length && data[end] != '\n'; end++)
+	  if(data[end] >= 0x40 && data[end] <= 0x7e)
+	    break;
+	if(end < length && data[end] == 'm'){
+	  sgr(&data[i + 2], &data[end], &fg, &bg);
+	  c = add_color(art, s, fg, bg);
+	  if(c == -1)
+	    return -1;
+	  color = c;
+	  if(first_color == -1)
+	    first_color = s->cell_count;
+	}
+	if(end < length && data[end] == '\n')
+	  end--;
+	i = end;
+	continue;
+      }
+      if(data[i + 1] >= '1' && data[i + 1] <= '8'){
+	color = data[i + 1] - '0';
+	fg = color - 1;
+	bg = 0;
+	if(first_color == -1)
+	  first_color = s->cell_count;
+      }
+      i++;
+      continue;
+    }
+
+    if(data[i] == '\n'){
+      if(add_line(s, line_start, color) == -1)
+	return -1;
+      line_start = s->cell_count;
+      bol = i + 1;
+      continue;
+    }
+
+    i += utf8_decode(&data[i], length - i, &cp) - 1;
+    if(add_cell(s, cp, color) == -1)
+      return -1;
+  }
+
+  /* Drop an empty trailing frame */
+  if(s->frame_count > 1 && s->frame_lines[s->frame_count - 1] == 0)
+    s->frame_count--;
+
+  /* Colors float: whatever was set last is still active when the object
+   * is drawn again, so cells before the first color code inherit it. */
+  art->tail_color = color;
+  if(first_color == -1)
+    first_color = s->cell_count;
+  for(i = 0; i < first_color; i++)
+    s->cell[i].color = color;
+  for(i = 0; i < s->line_count && s->line[i].start + s->line[i].length <= first_color; i++)
+    s->line[i].end_color = color;
+
+  return 0;
+}
+
+/* Lay out one frame in to a padded grid */
+static void fill(struct artEx *art, struct scratchEx *s, int line, int lines,
+                 struct cellEx *grid){
+  struct cellEx pad;
+  int r, c;
+
+  pad.ch = ' ';
+  pad.color = art->tail_color;
+  pad.width = 1;
+
+  for(r = 0; r < art->height; r++){
+    if(r < lines){
+      memcpy(&grid[r * art->width],
+             &s->cell[s->line[line + r].start],
+             s->line[line + r].length * sizeof(struct cellEx));
+      c = s->line[line + r].length;
+      pad.color = s->line[line + r].end_color;
+    }else{
+      c = 0;
+    }
+    for(; c < art->width; c++)
+      grid[r * art->width + c] = pad;
+  }
+}
+
+static int diff(struct artEx *art, struct cellEx *from, struct cellEx *to,
+                long *allocated, struct frameEx *frame){
+  struct deltaEx *d;
+  int cells = art->width * art->height;
+  int i;
+
+  /* Room for the worst case up front; no checks per changed cell */
+  art->delta[ART_NORMAL] = grow(art->delta[ART_NORMAL], sizeof(struct deltaEx),
+                                allocated, art->delta_count + cells);
+  if(art->delta[ART_NORMAL] == NULL)
+    return -1;
+
+  frame->delta_first = art->delta_count;
+  d = &art->delta[ART_NORMAL][art->delta_count];
+
+  for(i = 0; i < cells; i++){
+    if(from[i].ch == to[i].ch && from[i].color == to[i].color)
+      continue;
+    d->offset = i;
+    d->cell = to[i];
+    d++;
+  }
+
+  frame->delta_count = d - &art->delta[ART_NORMAL][frame->delta_first];
+  art->delta_count += frame->delta_count;
+
+  return 0;
+}
+
+/* Where a cell ends up when turned [orient]. Wide characters keep their
+ * left half on the left. */
+static int orient_offset(struct artEx *art, int orient, int offset, int width){
+  int r = offset / art->width;
+  int c = offset % art->width;
+
+  if(orient & ART_MIRROR)
+    switch(width){
+    case 2: c = art->width - 2 - c; break;
+    case 0: c = art->width - c; break;
+    default: c = art->width - 1 - c;
+    }
+
+  if(orient & ART_FLIP)
+    r = art->height - 1 - r;
+
+  return r * art->width + c;
+}
+
+static struct cellEx orient_cell(int orient, struct cellEx cell){
+  cell.ch = transform_glyph(orient, cell.ch);
+  return cell;
+}
+
+static int build_orient(struct artEx *art, int orient){
+  struct cellEx *cell;
+  struct deltaEx *delta;
+  int i;
+
+  art->cell[orient] = malloc(art->width * art->height * sizeof(struct cellEx) + 1);
+  art->delta[orient] = malloc(art->delta_count * sizeof(struct deltaEx) + 1);
+  if(art->cell[orient] == NULL || art->delta[orient] == NULL)
+    return -1;
+
+  cell = art->cell[ART_NORMAL];
+  for(i = 0; i < art->width * art->height; i++)
+    art->cell[orient][orient_offset(art, orient, i, cell[i].width)] = 
+      orient_cell(orient, cell[i]);
+
+  delta = art->delta[ART_NORMAL];
+  for(i = 0; i < art->delta_count; i++){
+    art->delta[orient][i].offset = orient_offset(art, orient, delta[i].offset,
+                                                 delta[i].cell.width);
+    art->delta[orient][i].cell = orient_cell(orient, delta[i].cell);
+  }
+
+  return 0;
+}
+
+/* Add the time since *[mark] to [total], when timing at all */
+static void lap(double *total, double *mark){
+  double now;
+
+  if(total == NULL)
+    return;
+  now = tickcount();
+  *total += now - *mark;
+  *mark = now;
+}
+
+/* [orients] is a mask of (1 << orientation) for the copies to build */
+struct artEx *art_parse(char *data, long length, int orients){
+  return art_parse_timed(data, length, orients, NULL);
+}
+
+/* art_parse(), adding the time each step took to [times] (if not NULL) */
+struct artEx *art_parse_timed(char *data, long length, int orients,
+                              struct artTimesEx *times){
+  struct scratchEx s;
+  struct artEx *art;
+  struct cellEx *prev;
+  struct cellEx *cur;
+  struct cellEx *swap;
+  long allocated;
+  double mark;
+  int line;
+  int i;
+
+  mark = times != NULL ? tickcount() : 0;
+  memset(&s, 0, sizeof(s));
+  prev = NULL;
+  cur = NULL;
+  allocated = 0;
+
+  art = calloc(1, sizeof(struct artEx));
+  if(art == NULL)
+    return NULL;
+  art->mirror = 1;
+
+  /* The classic colors always come first */
+  art->palette_count = ART_LEGACY_COLORS + 1;
+  art->palette = malloc(art->palette_count * sizeof(struct paletteEx));
+  s.palette_size = art->palette_count;
+  s.palette_chain = calloc(art->palette_count, sizeof(int));
+  if(art->palette == NULL || s.palette_chain == NULL)
+    goto fail;
+  for(i = 0; i < art->palette_count; i++){
+    art->palette[i].fg = i ? i - 1 : ART_DEFAULT_COLOR - 1;
+    art->palette[i].bg = 0;
+  }
+
+  if(scan(art, &s, data, length) == -1)
+    goto fail;
+  lap(times ? &times->scan : NULL, &mark);
+
+  /* Autopad every frame to the widest line and the tallest frame */
+  for(i = 0; i < s.line_count; i++)
+    if(s.line[i].length > art->width)
+      art->width = s.line[i].length;
+  for(i = 0; i < s.frame_count; i++)
+    if(s.frame_lines[i] > art->height)
+      art->height = s.frame_lines[i];
+  lap(times ? &times->width : NULL, &mark);
+
+  if(art->height == 0)
+    goto fail;
+
+  art->frame_count = s.frame_count;
+  art->frame = calloc(art->frame_count, sizeof(struct frameEx));
+  art->cell[ART_NORMAL] = malloc(art->width * art->height * sizeof(struct cellEx) + 1);
+  prev = malloc(art->width * art->height * sizeof(struct cellEx) + 1);
+  cur = malloc(art->width * art->height * sizeof(struct cellEx) + 1);
+  if(art->frame == NULL || art->cell[ART_NORMAL] == NULL || prev == NULL || cur == NULL)
+    goto fail;
+
+  /* Only two full frames are ever held besides frame 0 */
+  fill(art, &s, 0, s.frame_lines[0], art->cell[ART_NORMAL]);
+  memcpy(prev, art->cell[ART_NORMAL], art->width * art->height * sizeof(struct cellEx));
+  art->frame[0].duration = s.frame_duration[0];
+
+  line = s.frame_lines[0];
+  for(i = 1; i < art->frame_count; i++){
+    fill(art, &s, line, s.frame_lines[i], cur);
+    line += s.frame_lines[i];
+    art->frame[i].duration = s.frame_duration[i];
+    if(diff(art, prev, cur, &allocated, &art->frame[i]) == -1)
+      goto fail;
+    swap = prev;
+    prev = cur;
+    cur = swap;
+  }
+
+  /* Wrap around from the last frame back to frame 0 */
+  if(art->frame_count > 1)
+    if(diff(art, prev, art->cell[ART_NORMAL], &allocated, &art->frame[0]) == -1)
+      goto fail;
+
+  lap(times ? &times->pad : NULL, &mark);
+
+  /* ESC n: never turn this one */
+  art->orients = art->mirror ? orients | 1 << ART_NORMAL : 1 << ART_NORMAL;
+  for(i = 1; i < ART_ORIENTS; i++)
+    if(art->orients & 1 << i)
+      if(build_orient(art, i) == -1)
+        goto fail;
+  lap(times ? &times->orient : NULL, &mark);
+
+  free(prev);
+  free(cur);
+  free_scratch(&s);
+  return art;
+
+fail:
+  free(prev);
+  free(cur);
+  free_scratch(&s);
+  art_free(art);
+  return NULL;
+}
+
+/* Read and compile [file_name]. On failure NULL is returned and the
+ * reason is left in [error] (ART_ERROR_SIZE bytes). One open, one fstat
+ * and (normally) one read. */
+struct artEx *art_load(const char *file_name, int orients, char *error){
+  struct stat sc;
+  struct artEx *art;
+  char *data;
+  long size;
+  long got;
+  long n;
+  int fd;
+
+  fd = open(file_name, O_RDONLY);
+  if(fd == -1){
+    sprintf(error, "\"%.512s\" could not be read: %s\n", file_name, strerror(errno));
+    return NULL;
+  }
+
+  if(fstat(fd, &sc) == -1){
+    sprintf(error, "Cannot stat \"%.512s\": %s\n", file_name, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+
+  if(! S_ISREG(sc.st_mode)){
+    sprintf(error, "\"%.512s\" is not a regular file.\n", file_name);
+    close(fd);
+    return NULL;
+  }
+
+  if(sc.st_size == 0){
+    sprintf(error, "\"%.512s\" is empty.\n", file_name);
+    close(fd);
+    return NULL;
+  }
+
+  if(sc.st_size > MAX_ASCII_SIZE){
+    sprintf(error, "\"%.512s\" is too large(max %db allowed)\n",
+            file_name, MAX_ASCII_SIZE);
+    close(fd);
+    return NULL;
+  }
+
+  /* Loaded by another tss already */
+  art = share_find(&sc, orients);
+  if(art != NULL){
+    close(fd);
+    return art;
+  }
+
+  size = sc.st_size;
+  data = malloc(size);
+  if(data == NULL){
+    sprintf(error, "Out of memory.\n");
+    close(fd);
+    return NULL;
+  }
+
+  /* Short reads only happen on odd file systems, but happen */
+  for(got = 0; got < size; got += n){
+    n = read(fd, &data[got], size - got);
+    if(n <= 0)
+      break;
+  }
+  close(fd);
+
+  art = art_parse(data, got, orients);
+  free(data);
+
+  if(art != NULL && got == size)
+    share_publish(&sc, orients, art);
+
+  if(art == NULL)
+    sprintf(error, "\"%.512s\" contains no lines.\n", file_name);
+
+  return art;
+}
+
+void art_free(struct artEx *art){
+  int i;
+
+  if(art == NULL)
+    return;
+
+  if(art->shared != NULL){
+    share_unmap(art);
+    free(art);
+    return;
+  }
+
+  for(i = 0; i < ART_ORIENTS; i++){
+    free(art->cell[i]);
+    free(art->delta[i]);
+  }
+  free(art->frame);
+  free(art->palette);
+  free(art);
+}
+
+/* A private, writable copy of frame 0 to animate on */
+struct cellEx *art_grid_new(struct artEx *art, int orient){
+  struct cellEx *grid;
+
+  if(art->cell[orient] == NULL)
+    return NULL;
+
+  grid = malloc(art->width * art->height * sizeof(struct cellEx) + 1);
+  if(grid != NULL)
+    memcpy(grid, art->cell[orient], art->width * art->height * sizeof(struct cellEx));
+
+  return grid;
+}
+
+/* Step the grids of every orientation on to [frame] */
+void art_advance(struct artEx *art, int frame, struct cellEx **grid){
+  struct deltaEx *d;
+  int orient;
+  int i;
+
+  for(orient = 0; orient < ART_ORIENTS; orient++){
+    if(grid[orient] == NULL)
+      continue;
+    d = &art->delta[orient][art->frame[frame].delta_first];
+    for(i = 0; i < art->frame[frame].delta_count; i++)
+      grid[orient][d[i].offset] = d[i].cell;
+  }
+}
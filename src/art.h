@@ -0,0 +1,93 @@
+/* Terminal ScreenSaver - ASCII object loader
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * An ascii file is compiled once in to a grid of cells. Frame 0 is kept
+ * in full; every later frame is stored as the list of cells which differ
+ * from the frame before it, so animating costs only what actually changes.
+ * Mirrored and flipped copies of everything are made at load time.
+ */
+
+#ifndef TSS_ART_H
+#define TSS_ART_H
+
+#define ART_NORMAL		0
+#define ART_MIRROR		1	/* Left-right */
+#define ART_FLIP		2	/* Upside down */
+#define ART_ORIENTS		4	/* Any combination of the above */
+
+#define MAX_ASCII_SIZE		1024000
+#define ART_ERROR_SIZE		1024
+
+#define ART_DEFAULT_COLOR	8
+#define ART_LEGACY_COLORS	8
+#define ART_MAX_COLORS		65535
+#define ART_RGB			0x1000000L	/* 24 bit color flag */
+#define ART_FRAME_DURATION	200	/* Milliseconds */
+
+/* A wide character takes two cells; the right one has width 0 and is
+ * never drawn by itself. */
+struct cellEx{
+  unsigned int ch;		/* Unicode code point */
+  unsigned short color;		/* Index in to the palette */
+  unsigned char width;		/* Columns: 1, 2, or 0 */
+};
+
+/* Colors are xterm-256 color numbers or ART_RGB | 0xRRGGBB. Entries
+ * 1 - 8 are the classic ESC 1 .. ESC 8 colors on black. */
+struct paletteEx{
+  long fg;
+  long bg;
+};
+
+struct deltaEx{
+  int offset;			/* row * width + column */
+  struct cellEx cell;
+};
+
+struct frameEx{
+  int duration;			/* Milliseconds */
+  int delta_first;		/* Changes from the previous frame */
+  int delta_count;		/* (frame 0: from the last frame) */
+};
+
+struct artEx{
+  struct cellEx *cell[ART_ORIENTS];	/* Frame 0, width * height */
+  struct deltaEx *delta[ART_ORIENTS];
+  struct frameEx *frame;
+  struct paletteEx *palette;
+  int palette_count;
+  int frame_count;
+  int delta_count;
+  int width;
+  int height;
+  short mirror;			/* 0 if ESC n was given */
+  short orients;		/* Mask of orientations built */
+  short forced_direction;	/* ESC l / ESC r */
+  unsigned short tail_color;	/* Color left "floating" after drawing */
+  void *shared;			/* Mapped by share_find(), NULL if not */
+  long shared_size;
+};
+
+/* Seconds spent in each step of art_parse_timed() */
+struct artTimesEx{
+  double scan;			/* Bytes to cells, escapes, colors */
+  double width;			/* Widest line, tallest frame */
+  double pad;			/* Padded grids, frame deltas */
+  double orient;		/* Mirrored and flipped copies */
+};
+
+struct artEx *art_load(const char *file_name, int orients, char *error);
+struct artEx *art_parse(char *data, long length, int orients);
+struct artEx *art_parse_timed(char *data, long length, int orients,
+                              struct artTimesEx *times);
+void art_free(struct artEx *art);
+
+struct cellEx *art_grid_new(struct artEx *art, int orient);
+void art_advance(struct artEx *art, int frame, struct cellEx **grid);
+
+#endif
@@ -0,0 +1,358 @@
+/* Terminal ScreenSaver - color pair cache
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef BSD
+ #include <ncurses.h>
+#else
+ #include <curses.h>
+#endif
+
+#include "art.h"
+#include "color.h"
+
+#define LEGACY_PAIRS		8
+#define MAX_PAIRS		256	/* COLOR_PAIR() keeps 8 bits */
+#define HASH_SIZE		512
+#define KEY_SIZE		1024	/* Power of 2 */
+
+/* A pair of ours, for two colors as the terminal shows them */
+struct slotEx{
+  long fg;
+  long bg;
+  long fg_rgb;			/* As asked for, to find the nearest */
+  long bg_rgb;
+  long used;			/* Repaint it was last handed out in */
+  int version;			/* Counts redefinitions */
+  int pair;
+  int chain;			/* Hash bucket chain */
+};
+
+/* What a palette color combination was last given */
+struct keyEx{
+  long fg;
+  long bg;
+  long repaint;			/* Of a stand in, when it was chosen */
+  int version;			/* Of the slot, when it was chosen */
+  int slot;			/* -1 for the classic pairs */
+  short pair;			/* 0 is unused */
+  short exact;			/* Or the nearest there was */
+};
+
+static struct slotEx *slot;
+static struct keyEx key[KEY_SIZE];
+static int bucket[HASH_SIZE];
+static int slot_count;
+static int slot_max;
+static long repaint;
+static int starved;
+static int terminal_colors;
+
+static const unsigned char basic_rgb[16][3] = {
+  {  0,   0,   0}, {205,   0,   0}, {  0, 205,   0}, {205, 205,   0},
+  {  0,   0, 238}, {205,   0, 205}, {  0, 205, 205}, {229, 229, 229},
+  {127, 127, 127}, {255,   0,   0}, {  0, 255,   0}, {255, 255,   0},
+  { 92,  92, 255}, {255,   0, 255}, {  0, 255, 255}, {255, 255, 255}
+};
+
+static const unsigned char cube[6] = {0, 95, 135, 175, 215, 255};
+
+/* Red, green and blue of an xterm-256 color */
+static long palette_rgb(long n){
+  if(n < 16)
+    return basic_rgb[n][0] << 16 | basic_rgb[n][1] << 8 | basic_rgb[n][2];
+  if(n < 232){
+    n -= 16;
+    return (long)cube[n / 36] << 16 | cube[(n / 6) % 6] << 8 | cube[n % 6];
+  }
+  n = 8 + (n - 232) * 10;
+  return n << 16 | n << 8 | n;
+}
+
+static long distance(long a, long b){
+  long r = ((a >> 16) & 255) - ((b >> 16) & 255);
+  long g = ((a >> 8) & 255) - ((b >> 8) & 255);
+  long l = (a & 255) - (b & 255);
+  return r * r + g * g + l * l;
+}
+
+static int nearest_cube(int v){
+  int i;
+
+  for(i = 0; i < 5; i++)
+    if(v < (cube[i] + cube[i + 1]) / 2)
+      return i;
+  return 5;
+}
+
+/* Bring a color down to something the terminal can show */
+static long reduce(long color){
+  long rgb;
+  long best;
+  long n;
+  int r, g, b;
+  int i;
+
+  if(color & ART_RGB){
+    rgb = color & 0xffffff;
+    if(terminal_colors >= 0x1000000)
+      return rgb;			/* Direct color */
+    if(terminal_colors >= 256){
+      r = nearest_cube((rgb >> 16) & 255);
+      g = nearest_cube((rgb >> 8) & 255);
+      b = nearest_cube(rgb & 255);
+      n = 16 + r * 36 + g * 6 + b;
+      /* ..or the gray ramp, whichever is closer */
+      i = (((rgb >> 16) & 255) + ((rgb >> 8) & 255) + (rgb & 255)) / 3;
+      i = i < 8 ? 232 : (i > 238 ? 255 : 232 + (i - 3) / 10);
+      if(distance(palette_rgb(i), rgb) < distance(palette_rgb(n), rgb))
+        n = i;
+      return n;
+    }
+  }else{
+    if(color < terminal_colors)
+      return color;
+    rgb = palette_rgb(color);
+  }
+
+  n = terminal_colors >= 16 ? 16 : 8;
+  best = 0;
+  for(i = 1; i < n; i++)
+    if(distance(palette_rgb(i), rgb) < distance(palette_rgb(best), rgb))
+      best = i;
+  return best;
+}
+
+/* The nearest of the eight classic colors, for terminals nothing else is
+ * known about */
+int color_basic(long color){
+  long rgb;
+  int best;
+  int i;
+
+  if(!(color & ART_RGB) && color < 8)
+    return color;
+  rgb = color & ART_RGB ? color & 0xffffff : palette_rgb(color);
+
+  best = 0;
+  for(i = 1; i < 8; i++)
+    if(distance(palette_rgb(i), rgb) < distance(palette_rgb(best), rgb))
+      best = i;
+  return best;
+}
+
+static unsigned long hash(long fg, long bg){
+  return (unsigned long)fg * 31 + (unsigned long)bg * 131;
+}
+
+static long rgb_of(long color){
+  return color & ART_RGB ? color & 0xffffff : palette_rgb(color);
+}
+
+static void chain_unlink(int i){
+  int *p;
+
+  for(p = &bucket[hash(slot[i].fg, slot[i].bg) % HASH_SIZE]; *p != -1; p = &slot[*p].chain)
+    if(*p == i){
+      *p = slot[i].chain;
+      return;
+    }
+}
+
+/* The defined pair closest to [fg] on [bg]; its slot goes to [found],
+ * -1 for a classic pair */
+static int nearest(long fg, long bg, int *found){
+  long best;
+  long d;
+  int pair;
+  int i;
+
+  fg = rgb_of(fg);
+  bg = rgb_of(bg);
+
+  pair = 1;
+  *found = -1;
+  best = -1;
+  for(i = 0; i < LEGACY_PAIRS; i++){
+    d = distance(palette_rgb(i), fg) + distance(0, bg);
+    if(best == -1 || d < best){
+      best = d;
+      pair = i + 1;
+    }
+  }
+  for(i = 0; i < slot_count; i++){
+    d = distance(slot[i].fg_rgb, fg) + distance(slot[i].bg_rgb, bg);
+    if(d < best){
+      best = d;
+      pair = slot[i].pair;
+      *found = i;
+    }
+  }
+
+  return pair;
+}
+
+/* A slot which is not on screen, or -1 */
+static int unused_slot(void){
+  int best;
+  int i;
+
+  if(slot_count < slot_max){
+    slot[slot_count].pair = LEGACY_PAIRS + 1 + slot_count;
+    slot[slot_count].version = 0;
+    return slot_count++;
+  }
+
+  best = -1;
+  for(i = 0; i < slot_count; i++)
+    if(slot[i].used < repaint && (best == -1 || slot[i].used < slot[best].used))
+      best = i;
+  if(best != -1)
+    chain_unlink(best);
+  return best;
+}
+
+void color_init(void){
+  int i;
+
+  start_color(); /* VT100 Color init */
+  init_pair(1, COLOR_BLACK,	COLOR_BLACK);
+  init_pair(2, COLOR_RED,	COLOR_BLACK);
+  init_pair(3, COLOR_GREEN,	COLOR_BLACK);
+  init_pair(4, COLOR_YELLOW,	COLOR_BLACK);
+  init_pair(5, COLOR_BLUE,	COLOR_BLACK);
+  init_pair(6, COLOR_MAGENTA,	COLOR_BLACK);
+  init_pair(7, COLOR_CYAN,	COLOR_BLACK);
+  init_pair(8, COLOR_WHITE,	COLOR_BLACK);
+
+  terminal_colors = COLORS;
+  slot_max = (COLOR_PAIRS < MAX_PAIRS ? COLOR_PAIRS : MAX_PAIRS) - LEGACY_PAIRS - 1;
+  if(slot_max < 0)
+    slot_max = 0;
+
+  slot = calloc(slot_max + 1, sizeof(struct slotEx));
+  if(slot == NULL)
+    slot_max = 0;
+
+  for(i = 0; i < HASH_SIZE; i++)
+    bucket[i] = -1;
+  memset(key, 0, sizeof(key));
+  slot_count = 0;
+  repaint = 0;
+  starved = 0;
+}
+
+/* The whole screen is about to be drawn again: pairs not handed out from
+ * now on are off screen, and may be redefined */
+void color_repaint(void){
+  repaint++;
+  starved = 0;
+}
+
+/* Whether a color was given a stand in since the last repaint, for want
+ * of a pair which could be redefined */
+int color_starved(void){
+  return starved;
+}
+
+/* The pair to draw [fg] on [bg] with. Colors are as in struct paletteEx. */
+int color_pair(long fg, long bg){
+  struct keyEx *k;
+  long rfg, rbg;
+  int h;
+  int i;
+
+  /* A span switch is this lookup */
+  k = &key[hash(fg, bg) & (KEY_SIZE - 1)];
+  if(k->pair != 0 && k->fg == fg && k->bg == bg &&
+     (k->slot == -1 || slot[k->slot].version == k->version) &&
+     (k->exact || k->repaint == repaint)){
+    if(k->slot != -1)
+      slot[k->slot].used = repaint;
+    return k->pair;
+  }
+
+  k->fg		= fg;
+  k->bg		= bg;
+  k->slot	= -1;
+  k->exact	= 1;
+
+  rfg = reduce(fg);
+  rbg = reduce(bg);
+
+  /* The classic pairs need no slot */
+  if(rbg == COLOR_BLACK && rfg >= 0 && rfg < LEGACY_PAIRS){
+    k->pair = rfg + 1;
+    return k->pair;
+  }
+
+  if(slot_max == 0){
+    k->pair = rfg >= 0 && rfg < LEGACY_PAIRS ? rfg + 1 : LEGACY_PAIRS;
+    return k->pair;
+  }
+
+  h = hash(rfg, rbg) % HASH_SIZE;
+  for(i = bucket[h]; i != -1; i = slot[i].chain)
+    if(slot[i].fg == rfg && slot[i].bg == rbg)
+      break;
+
+  /* Cells still showing a pair would change color with it, so only a
+   * pair nobody drew since the last repaint is redefined */
+  if(i == -1 && (i = unused_slot()) != -1){
+    slot[i].fg		= rfg;
+    slot[i].bg		= rbg;
+    slot[i].fg_rgb	= rgb_of(fg);
+    slot[i].bg_rgb	= rgb_of(bg);
+    slot[i].version++;
+    slot[i].chain	= bucket[h];
+    bucket[h]		= i;
+
+#ifdef NCURSES_EXT_COLORS
+    init_extended_pair(slot[i].pair, rfg, rbg);
+#else
+    init_pair(slot[i].pair, rfg, rbg);
+#endif
+  }
+
+  if(i == -1){
+    k->pair	= nearest(fg, bg, &i);
+    k->exact	= 0;
+    k->repaint	= repaint;
+    starved	= 1;
+  }else{
+    k->pair	= slot[i].pair;
+  }
+
+  k->slot = i;
+  if(i != -1){
+    k->version = slot[i].version;
+    slot[i].used = repaint;
+  }
+  return k->pair;
+}
+
+void color_free(void){
+  free(slot);
+  slot = NULL;
+  slot_max = 0;
+  slot_count = 0;
+  memset(key, 0, sizeof(key));
+}
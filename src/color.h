@@ -0,0 +1,26 @@
+/* Terminal ScreenSaver - color pair cache
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Pairs 1 - 8 are the classic ESC 1 .. ESC 8 colors. Every other
+ * foreground/background combination gets a pair the first time it is
+ * drawn. When the terminal runs out of pairs, one is only redefined if
+ * nothing drew it since the screen was last drawn anew (color_repaint());
+ * otherwise the color gets the nearest pair there is.
+ */
+
+#ifndef TSS_COLOR_H
+#define TSS_COLOR_H
+
+void color_init(void);
+int color_pair(long fg, long bg);
+void color_repaint(void);
+int color_starved(void);
+void color_free(void);
+int color_basic(long color);
+
+#endif
@@ -0,0 +1,246 @@
+/* Terminal ScreenSaver - tiled compositor
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * Tiles are handed out from a shared counter, so a thread which finishes
+ * a cheap tile just takes the next one. The caller works on tiles too and
+ * only returns once every tile of the frame is done. A tile only writes
+ * its own rows, of the cell buffer and of the effect.
+ *
+ * */
+
+#define _XOPEN_SOURCE	500
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "compose.h"
+
+static void put(struct cellEx *cell, unsigned int ch, unsigned short color){
+  cell->ch	= ch;
+  cell->color	= color;
+  cell->width	= 1;
+}
+
+static void compose_tile(struct composeEx *c, int tile){
+  struct sceneEx *s = c->scene;
+  struct spriteEx *sp = &s->sprite;
+  struct cellEx *row;
+  unsigned char *level;
+  const char *text;
+  int first, last;
+  int x, y, i;
+  int x0, x1;
+
+  first = tile * c->tile_height;
+  last = first + c->tile_height;
+  if(last > c->height)
+    last = c->height;
+
+  /* Background */
+  if(s->effect != NULL){
+    effect_rows(s->effect, first, last);
+    for(y = first; y < last; y++){
+      row = &c->back[y * c->width];
+      level = &s->effect->level[y * c->width];
+      for(x = 0; x < c->width; x++)
+        put(&row[x], effect_glyph(s->effect, level[x], x, y),
+            effect_color(s->effect, level[x]));
+    }
+  }else{
+    for(y = first; y < last; y++){
+      row = &c->back[y * c->width];
+      for(x = 0; x < c->width; x++)
+        put(&row[x], ' ', ART_DEFAULT_COLOR);
+    }
+  }
+
+  /* Particles */
+  if(s->particles != NULL)
+    for(i = 0; i < s->particles->count; i++){
+      x = s->particles->x[i];
+      y = s->particles->y[i];
+      if(y >= first && y < last && x >= 0 && x < c->width)
+        put(&c->back[y * c->width + x], particles_glyph(s->particles, i),
+            particles_color(s->particles, i));
+    }
+
+  /* Ascii object */
+  if(sp->cell != NULL){
+    x0 = sp->x < 0 ? -sp->x : 0;
+    x1 = sp->x + sp->width > c->width ? c->width - sp->x : sp->width;
+    for(y = sp->y > first ? sp->y : first; y < sp->y + sp->height && y < last; y++)
+      if(x1 > x0)
+        memcpy(&c->back[y * c->width + sp->x + x0],
+               &sp->cell[(y - sp->y) * sp->width + x0],
+               (x1 - x0) * sizeof(struct cellEx));
+  }
+
+  /* Names */
+  for(i = 0; i < s->label_count; i++){
+    if(s->label[i].y < first || s->label[i].y >= last)
+      continue;
+    row = &c->back[s->label[i].y * c->width];
+    text = s->label[i].text;
+    for(x = s->label[i].x; *text != 0 && x < c->width; x++, text++)
+      if(x >= 0)
+        put(&row[x], (unsigned char)*text, s->label_color);
+  }
+}
+
+/* A frame has a few dozen tiles at most; taking the lock per tile is
+ * nothing next to filling one */
+static void run_tiles(struct composeEx *c){
+  int tile;
+
+  pthread_mutex_lock(&c->lock);
+  while(c->next_tile < c->tiles){
+    tile = c->next_tile++;
+    pthread_mutex_unlock(&c->lock);
+
+    compose_tile(c, tile);
+
+    pthread_mutex_lock(&c->lock);
+    if(++c->tiles_done == c->tiles)
+      pthread_cond_signal(&c->done);
+  }
+  pthread_mutex_unlock(&c->lock);
+}
+
+static void *worker_main(void *arg){
+  struct composeEx *c = arg;
+  long seen = 0;
+
+  pthread_mutex_lock(&c->lock);
+  for(;;){
+    while(!c->quit && c->generation == seen)
+      pthread_cond_wait(&c->start, &c->lock);
+    if(c->quit)
+      break;
+    seen = c->generation;
+    pthread_mutex_unlock(&c->lock);
+
+    run_tiles(c);
+
+    pthread_mutex_lock(&c->lock);
+  }
+  pthread_mutex_unlock(&c->lock);
+
+  return NULL;
+}
+
+struct composeEx *compose_new(int width, int height, int tiles, int threads){
+  struct composeEx *c;
+  sigset_t all;
+  sigset_t old;
+  int i;
+
+  c = calloc(1, sizeof(struct composeEx));
+  if(c == NULL)
+    return NULL;
+
+  if(threads < 1)
+    threads = 1;
+  if(threads > COMPOSE_MAX_THREADS)
+    threads = COMPOSE_MAX_THREADS;
+  if(tiles < 1)
+    tiles = 1;
+  if(tiles > height)
+    tiles = height;
+
+  c->width	= width;
+  c->height	= height;
+  c->tile_height= (height + tiles - 1) / tiles;
+  c->tiles	= (height + c->tile_height - 1) / c->tile_height;
+  c->back	= malloc((long)width * height * sizeof(struct cellEx));
+  c->front	= malloc((long)width * height * sizeof(struct cellEx));
+  c->worker	= calloc(threads, sizeof(pthread_t));
+  pthread_mutex_init(&c->lock, NULL);
+  pthread_cond_init(&c->start, NULL);
+  pthread_cond_init(&c->done, NULL);
+
+  if(c->back == NULL || c->front == NULL || c->worker == NULL){
+    compose_free(c);
+    return NULL;
+  }
+  compose_invalidate(c);
+
+  /* Signals (VT switching) must keep going to the main thread */
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  for(i = 1; i < threads; i++){
+    if(pthread_create(&c->worker[i], NULL, worker_main, c) != 0)
+      break;
+    c->threads = i;
+  }
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  c->threads++;		/* The caller */
+
+  return c;
+}
+
+void compose_free(struct composeEx *c){
+  int i;
+
+  if(c == NULL)
+    return;
+
+  pthread_mutex_lock(&c->lock);
+  c->quit = 1;
+  pthread_cond_broadcast(&c->start);
+  pthread_mutex_unlock(&c->lock);
+  for(i = 1; i < c->threads; i++)
+    pthread_join(c->worker[i], NULL);
+
+  pthread_mutex_destroy(&c->lock);
+  pthread_cond_destroy(&c->start);
+  pthread_cond_destroy(&c->done);
+  free(c->worker);
+  free(c->back);
+  free(c->front);
+  free(c);
+}
+
+/* Fill c->back from [scene]. With one thread this is just a loop over the
+ * tiles; with more, the results are the same cell for cell. */
+void compose_frame(struct composeEx *c, struct sceneEx *scene){
+  pthread_mutex_lock(&c->lock);
+  c->scene	= scene;
+  c->tiles_done	= 0;
+  c->next_tile	= 0;
+  c->generation++;
+  pthread_cond_broadcast(&c->start);
+  pthread_mutex_unlock(&c->lock);
+
+  run_tiles(c);
+
+  pthread_mutex_lock(&c->lock);
+  while(c->tiles_done < c->tiles)
+    pthread_cond_wait(&c->done, &c->lock);
+  pthread_mutex_unlock(&c->lock);
+}
+
+/* The screen no longer shows c->front (cleared, or the palette changed) */
+void compose_invalidate(struct composeEx *c){
+  long i;
+
+  for(i = 0; i < (long)c->width * c->height; i++)
+    c->front[i].ch = COMPOSE_UNKNOWN;
+}
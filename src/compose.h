@@ -0,0 +1,76 @@
+/* Terminal ScreenSaver - tiled compositor
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The whole screen is put together in a cell buffer before anything goes
+ * to curses. The buffer is cut in to bands of rows (tiles) which a small
+ * pool of threads fills at the same time: effect rows first, then
+ * particles, the ascii object, and the names on top. Drawing only what
+ * differs from the previous buffer is left to the caller, in one pass.
+ */
+
+#ifndef TSS_COMPOSE_H
+#define TSS_COMPOSE_H
+
+#include <pthread.h>
+
+#include "art.h"
+#include "effect.h"
+#include "particle.h"
+
+#define COMPOSE_LABELS		6	/* Names and --label */
+#define COMPOSE_MAX_THREADS	64
+#define COMPOSE_UNKNOWN		0xffffffffU	/* Cell not on screen yet */
+
+struct spriteEx{
+  struct cellEx *cell;		/* NULL for none */
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+struct labelEx{
+  const char *text;
+  int x;
+  int y;
+};
+
+struct sceneEx{
+  struct effectEx *effect;	/* NULL for a blank background */
+  struct particlesEx *particles;	/* Behind the sprite; may be NULL */
+  struct spriteEx sprite;
+  struct labelEx label[COMPOSE_LABELS];
+  int label_count;
+  unsigned short label_color;
+};
+
+struct composeEx{
+  int width;
+  int height;
+  int tiles;
+  int tile_height;
+  int threads;			/* Including the caller */
+  struct cellEx *back;		/* Being composed */
+  struct cellEx *front;		/* On screen */
+  struct sceneEx *scene;
+  pthread_t *worker;
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  long generation;
+  int next_tile;
+  int tiles_done;
+  int quit;
+};
+
+struct composeEx *compose_new(int width, int height, int tiles, int threads);
+void compose_free(struct composeEx *c);
+void compose_frame(struct composeEx *c, struct sceneEx *scene);
+void compose_invalidate(struct composeEx *c);
+
+#endif
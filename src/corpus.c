@@ -0,0 +1,165 @@
+/* Terminal ScreenSaver - synthetic ascii and loader benchmarks
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * The same seed always makes the same ascii, so runs can be compared.
+ * Lines are between half and all of the width long, which leaves the
+ * padding something to do. Half of the color escapes are ESC 1 .. ESC 8,
+ * the other half 256 color SGR sequences, which go through the palette.
+ *
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "corpus.h"
+#include "tick.h"
+
+#define MIN_TIME		0.05	/* Seconds of loading per measurement */
+
+static const int sizes[] = {10, 32, 100, 316, 1000};
+static const int color_shares[] = {0, 10, 50};
+static const int mirror_shares[] = {0, 50};
+
+static const char plain[] = "abcdefghijklmnopqrstuvwxyz.,:;'`-_=+*#@|!^~ ";
+static const char mirrored[] = "()<>[]{}/\\";
+
+/* 0 .. 99 */
+static int percent(unsigned long *seed){
+  *seed = *seed * 1103515245 + 12345;
+  return (*seed >> 16) % 100;
+}
+
+static int pick(unsigned long *seed, int n){
+  *seed = *seed * 1103515245 + 12345;
+  return (*seed >> 16) % n;
+}
+
+/* An ascii file [width] by [height]; [colors] percent of the characters
+ * get a color escape first and [mirrors] percent of them are ones that
+ * change when mirrored. NULL when out of memory. */
+char *corpus_art(int width, int height, int colors, int mirrors,
+                 unsigned long seed, long *length){
+  char *text, *t;
+  int length_of_line;
+  int r, c;
+
+  /* At most "ESC [ 38;5;nnn m" and a character per cell */
+  text = malloc((long)height * (width * 12L + 1) + 1);
+  if(text == NULL)
+    return NULL;
+
+  t = text;
+  for(r = 0; r < height; r++){
+    length_of_line = r == 0 ? width : width - pick(&seed, width / 2 + 1);
+    for(c = 0; c < length_of_line; c++){
+      if(percent(&seed) < colors){
+        if(pick(&seed, 2)){
+          *t++ = 27;
+          *t++ = '1' + pick(&seed, 8);
+        }else{
+          t += sprintf(t, "\033[38;5;%dm", pick(&seed, 256));
+        }
+      }
+      if(percent(&seed) < mirrors)
+        *t++ = mirrored[pick(&seed, sizeof(mirrored) - 1)];
+      else
+        *t++ = plain[pick(&seed, sizeof(plain) - 1)];
+    }
+    *t++ = '\n';
+  }
+
+  *length = t - text;
+  return text;
+}
+
+/* Load (and draw, unless [draw] is NULL) every kind of corpus ascii and
+ * show nanoseconds per cell for each step */
+void corpus_bench(corpus_drawEx draw){
+  struct artTimesEx times;
+  struct artEx *art;
+  struct cellEx *grid;
+  double begin, drawing;
+  double cells;
+  char *text;
+  long length;
+  long runs;
+  int size, colors, mirrors;
+  int orients;
+
+  orients = 1 << ART_MIRROR | 1 << ART_FLIP | 1 << (ART_MIRROR | ART_FLIP);
+
+  printf("Ascii loading and drawing, nanoseconds per cell:\n\n");
+  printf("%-11s %6s %7s %8s %8s %8s %8s %8s %8s\n",
+         "size", "color", "mirror", "scan", "width", "pad", "orient", "draw", "total");
+
+  for(size = 0; size < (int)(sizeof(sizes) / sizeof(sizes[0])); size++)
+    for(colors = 0; colors < (int)(sizeof(color_shares) / sizeof(color_shares[0])); colors++)
+      for(mirrors = 0; mirrors < (int)(sizeof(mirror_shares) / sizeof(mirror_shares[0])); mirrors++){
+        printf("%5dx%-5d %5d%% %6d%% ", sizes[size], sizes[size],
+               color_shares[colors], mirror_shares[mirrors]);
+        fflush(stdout);
+
+        text = corpus_art(sizes[size], sizes[size], color_shares[colors],
+                          mirror_shares[mirrors], 1, &length);
+        if(text == NULL){
+          printf("%8s\n", "nomem");
+          continue;
+        }
+
+        memset(&times, 0, sizeof(times));
+        drawing = 0;
+        cells = 0;
+        runs = 0;
+        begin = tickcount();
+        do{
+          art = art_parse_timed(text, length, orients, &times);
+          if(art == NULL)
+            break;
+          cells = (double)art->width * art->height;
+
+          if(draw != NULL){
+            grid = art_grid_new(art, ART_NORMAL);
+            drawing -= tickcount();
+            draw(art, grid);
+            drawing += tickcount();
+            free(grid);
+          }
+
+          art_free(art);
+          runs++;
+        }while(tickcount() - begin < MIN_TIME);
+        free(text);
+
+        if(runs == 0){
+          printf("%8s\n", "nomem");
+          continue;
+        }
+
+        cells *= runs / 1e9;
+        printf("%8.2f %8.2f %8.2f %8.2f ", times.scan / cells, times.width / cells,
+               times.pad / cells, times.orient / cells);
+        if(draw != NULL)
+          printf("%8.2f ", drawing / cells);
+        else
+          printf("%8s ", "-");
+        printf("%8.2f\n", (times.scan + times.width + times.pad + times.orient +
+                           drawing) / cells);
+      }
+}
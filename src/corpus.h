@@ -0,0 +1,28 @@
+/* Terminal ScreenSaver - synthetic ascii and loader benchmarks
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Real ascii files are a couple of dozen lines at most. To see how the
+ * loader does on big ones, corpus_art() makes up ascii of any size, with
+ * a given share of color escapes and of characters which change when
+ * mirrored. corpus_bench() runs the loader over a range of them and shows
+ * what each step costs per cell (--bench-art, or make bench).
+ */
+
+#ifndef TSS_CORPUS_H
+#define TSS_CORPUS_H
+
+#include "art.h"
+
+/* Draws [grid], frame 0 of [art], the way the main loop would */
+typedef void (*corpus_drawEx)(struct artEx *art, struct cellEx *grid);
+
+char *corpus_art(int width, int height, int colors, int mirrors,
+                 unsigned long seed, long *length);
+void corpus_bench(corpus_drawEx draw);
+
+#endif
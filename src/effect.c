@@ -0,0 +1,648 @@
+/* Terminal ScreenSaver - full screen effects
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * Every per-cell loop lives in one of four kernels (decay, plasma, fire
+ * and quantize), each in a plain C, SSE2 and AVX2 flavour. Everything
+ * else (stars, rain drops, the fire's fuel) touches a handful of cells
+ * per frame and stays scalar.
+ *
+ * */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+ #define HAVE_X86
+ #include <immintrin.h>
+#endif
+
+#include "effect.h"
+#include "tick.h"
+
+#define TWO_PI			6.28318531f
+#define INV_TWO_PI		0.159154943f
+#define SIN_B			1.27323954f	/*  4 / pi   */
+#define SIN_C			-0.405284735f	/* -4 / pi^2 */
+#define SIN_P			0.225f
+
+#define FIRE_DECAY		0.2475f		/* Just under 1/4 */
+#define MATRIX_DECAY		0.9f
+#define STAR_DECAY		0.6f
+
+struct kernelsEx{
+  void (*decay)(float *v, int n, float f);
+  void (*plasma)(float *out, const float *dist, const float *col,
+                 const float *xc, float row, float base, float t, int n);
+  void (*fire)(float *out, const float *below, const float *below2, int n);
+  void (*quantize)(const float *v, unsigned char *level, int n);
+};
+
+static const char *names[EFFECT_COUNT] = {
+  "plasma", "matrix", "starfield", "fire"
+};
+
+static const char *path_names[EFFECT_PATHS] = {
+  "scalar", "sse2", "avx2"
+};
+
+static const char ramp[EFFECT_COUNT][EFFECT_LEVELS + 1] = {
+  " .':;-=+*xoO#%@@",
+  "                ",		/* Glyphs come from matrix_chars */
+  " ...,,++**##@@@@",
+  " ..::;;**##%%@@&"
+};
+
+static const unsigned char pairs[EFFECT_COUNT][EFFECT_LEVELS] = {
+  {5, 5, 5, 6, 6, 6, 7, 7, 3, 3, 4, 4, 2, 2, 8, 8},
+  {3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 8},
+  {5, 5, 5, 5, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8, 8},
+  {1, 1, 2, 2, 2, 2, 2, 4, 4, 4, 4, 4, 8, 8, 8, 8}
+};
+
+static const char matrix_chars[] = "0123456789ABCDEFZ$+-*/=%\"'#&_(),.;:?!|{}<>[]^~";
+
+/*** Plain C ***/
+
+static float sin_scalar(float x){
+  float y;
+
+  x *= INV_TWO_PI;
+  x -= (float)(int)(x + (x >= 0 ? 0.5f : -0.5f));
+  x *= TWO_PI;
+  y = SIN_B * x + SIN_C * x * (x < 0 ? -x : x);
+  return SIN_P * (y * (y < 0 ? -y : y) - y) + y;
+}
+
+static void decay_scalar(float *v, int n, float f){
+  int i;
+
+  for(i = 0; i < n; i++)
+    v[i] *= f;
+}
+
+static void plasma_scalar(float *out, const float *dist, const float *col,
+                          const float *xc, float row, float base, float t, int n){
+  int i;
+
+  for(i = 0; i < n; i++)
+    out[i] = (col[i] + row + sin_scalar(xc[i] + base) + sin_scalar(dist[i] - t))
+             * 0.125f + 0.5f;
+}
+
+static void fire_scalar(float *out, const float *below, const float *below2, int n){
+  int i;
+
+  for(i = 0; i < n; i++)
+    out[i] = (below[i - 1] + below[i] + below[i + 1] + below2[i]) * FIRE_DECAY;
+}
+
+static void quantize_scalar(const float *v, unsigned char *level, int n){
+  float q;
+  int i;
+
+  for(i = 0; i < n; i++){
+    q = v[i] * EFFECT_LEVELS;
+    if(q < 0)
+      q = 0;
+    if(q > EFFECT_LEVELS - 1)
+      q = EFFECT_LEVELS - 1;
+    level[i] = (unsigned char)q;
+  }
+}
+
+#ifdef HAVE_X86
+
+/*** SSE2 ***/
+
+static __m128 sin_sse2(__m128 x){
+  __m128 sign = _mm_set1_ps(-0.0f);
+  __m128 y;
+
+  x = _mm_mul_ps(x, _mm_set1_ps(INV_TWO_PI));
+  x = _mm_sub_ps(x, _mm_cvtepi32_ps(_mm_cvtps_epi32(x)));
+  x = _mm_mul_ps(x, _mm_set1_ps(TWO_PI));
+  y = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_B), x),
+                 _mm_mul_ps(_mm_set1_ps(SIN_C), _mm_mul_ps(x, _mm_andnot_ps(sign, x))));
+  return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P),
+                               _mm_sub_ps(_mm_mul_ps(y, _mm_andnot_ps(sign, y)), y)), y);
+}
+
+static void decay_sse2(float *v, int n, float f){
+  __m128 m = _mm_set1_ps(f);
+  int i;
+
+  for(i = 0; i + 4 <= n; i += 4)
+    _mm_storeu_ps(&v[i], _mm_mul_ps(_mm_loadu_ps(&v[i]), m));
+  decay_scalar(&v[i], n - i, f);
+}
+
+static void plasma_sse2(float *out, const float *dist, const float *col,
+                        const float *xc, float row, float base, float t, int n){
+  __m128 r = _mm_set1_ps(row);
+  __m128 b = _mm_set1_ps(base);
+  __m128 tt = _mm_set1_ps(t);
+  __m128 s;
+  int i;
+
+  for(i = 0; i + 4 <= n; i += 4){
+    s = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(&col[i]), r),
+                   _mm_add_ps(sin_sse2(_mm_add_ps(_mm_loadu_ps(&xc[i]), b)),
+                              sin_sse2(_mm_sub_ps(_mm_loadu_ps(&dist[i]), tt))));
+    _mm_storeu_ps(&out[i], _mm_add_ps(_mm_mul_ps(s, _mm_set1_ps(0.125f)), _mm_set1_ps(0.5f)));
+  }
+  plasma_scalar(&out[i], &dist[i], &col[i], &xc[i], row, base, t, n - i);
+}
+
+static void fire_sse2(float *out, const float *below, const float *below2, int n){
+  __m128 s;
+  int i;
+
+  for(i = 0; i + 4 <= n; i += 4){
+    s = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(&below[i - 1]), _mm_loadu_ps(&below[i])),
+                   _mm_add_ps(_mm_loadu_ps(&below[i + 1]), _mm_loadu_ps(&below2[i])));
+    _mm_storeu_ps(&out[i], _mm_mul_ps(s, _mm_set1_ps(FIRE_DECAY)));
+  }
+  fire_scalar(&out[i], &below[i], &below2[i], n - i);
+}
+
+static __m128i quantize4_sse2(const float *v){
+  __m128 q;
+
+  q = _mm_mul_ps(_mm_loadu_ps(v), _mm_set1_ps(EFFECT_LEVELS));
+  q = _mm_min_ps(_mm_max_ps(q, _mm_setzero_ps()), _mm_set1_ps(EFFECT_LEVELS - 1));
+  return _mm_cvttps_epi32(q);
+}
+
+static void quantize_sse2(const float *v, unsigned char *level, int n){
+  __m128i a, b;
+  int i;
+
+  for(i = 0; i + 16 <= n; i += 16){
+    a = _mm_packs_epi32(quantize4_sse2(&v[i]), quantize4_sse2(&v[i + 4]));
+    b = _mm_packs_epi32(quantize4_sse2(&v[i + 8]), quantize4_sse2(&v[i + 12]));
+    _mm_storeu_si128((__m128i *)&level[i], _mm_packus_epi16(a, b));
+  }
+  quantize_scalar(&v[i], &level[i], n - i);
+}
+
+/*** AVX2 ***/
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static __m256 sin_avx2(__m256 x){
+  __m256 sign = _mm256_set1_ps(-0.0f);
+  __m256 y;
+
+  x = _mm256_mul_ps(x, _mm256_set1_ps(INV_TWO_PI));
+  x = _mm256_sub_ps(x, _mm256_cvtepi32_ps(_mm256_cvtps_epi32(x)));
+  x = _mm256_mul_ps(x, _mm256_set1_ps(TWO_PI));
+  y = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_B), x),
+                    _mm256_mul_ps(_mm256_set1_ps(SIN_C),
+                                  _mm256_mul_ps(x, _mm256_andnot_ps(sign, x))));
+  return _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_P),
+                                     _mm256_sub_ps(_mm256_mul_ps(y, _mm256_andnot_ps(sign, y)), y)), y);
+}
+
+AVX2 static void decay_avx2(float *v, int n, float f){
+  __m256 m = _mm256_set1_ps(f);
+  int i;
+
+  for(i = 0; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(&v[i], _mm256_mul_ps(_mm256_loadu_ps(&v[i]), m));
+  decay_scalar(&v[i], n - i, f);
+}
+
+AVX2 static void plasma_avx2(float *out, const float *dist, const float *col,
+                             const float *xc, float row, float base, float t, int n){
+  __m256 r = _mm256_set1_ps(row);
+  __m256 b = _mm256_set1_ps(base);
+  __m256 tt = _mm256_set1_ps(t);
+  __m256 s;
+  int i;
+
+  for(i = 0; i + 8 <= n; i += 8){
+    s = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(&col[i]), r),
+                      _mm256_add_ps(sin_avx2(_mm256_add_ps(_mm256_loadu_ps(&xc[i]), b)),
+                                    sin_avx2(_mm256_sub_ps(_mm256_loadu_ps(&dist[i]), tt))));
+    _mm256_storeu_ps(&out[i], _mm256_add_ps(_mm256_mul_ps(s, _mm256_set1_ps(0.125f)),
+                                            _mm256_set1_ps(0.5f)));
+  }
+  plasma_scalar(&out[i], &dist[i], &col[i], &xc[i], row, base, t, n - i);
+}
+
+AVX2 static void fire_avx2(float *out, const float *below, const float *below2, int n){
+  __m256 s;
+  int i;
+
+  for(i = 0; i + 8 <= n; i += 8){
+    s = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(&below[i - 1]), _mm256_loadu_ps(&below[i])),
+                      _mm256_add_ps(_mm256_loadu_ps(&below[i + 1]), _mm256_loadu_ps(&below2[i])));
+    _mm256_storeu_ps(&out[i], _mm256_mul_ps(s, _mm256_set1_ps(FIRE_DECAY)));
+  }
+  fire_scalar(&out[i], &below[i], &below2[i], n - i);
+}
+
+AVX2 static void quantize_avx2(const float *v, unsigned char *level, int n){
+  __m256 q;
+  __m256i a, b;
+  __m128i lo, hi;
+  int i;
+
+  for(i = 0; i + 16 <= n; i += 16){
+    q = _mm256_mul_ps(_mm256_loadu_ps(&v[i]), _mm256_set1_ps(EFFECT_LEVELS));
+    q = _mm256_min_ps(_mm256_max_ps(q, _mm256_setzero_ps()), _mm256_set1_ps(EFFECT_LEVELS - 1));
+    a = _mm256_cvttps_epi32(q);
+    q = _mm256_mul_ps(_mm256_loadu_ps(&v[i + 8]), _mm256_set1_ps(EFFECT_LEVELS));
+    q = _mm256_min_ps(_mm256_max_ps(q, _mm256_setzero_ps()), _mm256_set1_ps(EFFECT_LEVELS - 1));
+    b = _mm256_cvttps_epi32(q);
+    /* Packing works per 128 bit lane, so put the lanes back in order */
+    a = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8);
+    lo = _mm256_castsi256_si128(a);
+    hi = _mm256_extracti128_si256(a, 1);
+    _mm_storeu_si128((__m128i *)&level[i], _mm_packus_epi16(lo, hi));
+  }
+  quantize_scalar(&v[i], &level[i], n - i);
+}
+
+#endif /* HAVE_X86 */
+
+static struct kernelsEx kernels[EFFECT_PATHS] = {
+  {decay_scalar, plasma_scalar, fire_scalar, quantize_scalar},
+#ifdef HAVE_X86
+  {decay_sse2, plasma_sse2, fire_sse2, quantize_sse2},
+  {decay_avx2, plasma_avx2, fire_avx2, quantize_avx2}
+#else
+  {NULL, NULL, NULL, NULL},
+  {NULL, NULL, NULL, NULL}
+#endif
+};
+
+static int path_available(int path){
+  if(kernels[path].decay == NULL)
+    return 0;
+#ifdef HAVE_X86
+  if(path == EFFECT_AVX2)
+    return __builtin_cpu_supports("avx2");
+  if(path == EFFECT_SSE2)
+    return __builtin_cpu_supports("sse2");
+#endif
+  return 1;
+}
+
+int effect_best_path(void){
+  int path;
+
+  for(path = EFFECT_PATHS - 1; path > EFFECT_SCALAR; path--)
+    if(path_available(path))
+      return path;
+  return EFFECT_SCALAR;
+}
+
+int effect_find(const char *name){
+  int i;
+
+  for(i = 0; i < EFFECT_COUNT; i++)
+    if(strcmp(name, names[i]) == 0)
+      return i;
+  return -1;
+}
+
+const char *effect_name(int kind){
+  return names[kind];
+}
+
+static float random_float(struct effectEx *e){
+  e->seed = e->seed * 1103515245 + 12345;
+  return ((e->seed >> 8) & 0xffff) / 65536.0f;
+}
+
+static int star_count(struct effectEx *e){
+  int n = e->width * e->height / 40;
+  return n < 16 ? 16 : n;
+}
+
+static void star_reset(struct effectEx *e, float *star, float z){
+  star[0] = random_float(e) * 2 - 1;
+  star[1] = random_float(e) * 2 - 1;
+  star[2] = z;
+}
+
+struct effectEx *effect_new(int kind, int width, int height, int path){
+  struct effectEx *e;
+  long cells;
+  long aux;
+  int x, y;
+  float dx, dy;
+
+  e = calloc(1, sizeof(struct effectEx));
+  if(e == NULL)
+    return NULL;
+
+  e->kind	= kind;
+  e->width	= width;
+  e->height	= height;
+  e->path	= path_available(path) ? path : EFFECT_SCALAR;
+  e->seed	= 0x1234567;
+  cells		= (long)width * height;
+
+  switch(kind){
+  case EFFECT_PLASMA:	aux = cells + 2 * width; break;
+  case EFFECT_MATRIX:	aux = 3 * width; break;
+  case EFFECT_STARFIELD:	aux = 3 * star_count(e); break;
+  default:		aux = 2L * (width + 2) * (height + 2);
+  }
+
+  e->v		= calloc(cells + 1, sizeof(float));
+  e->aux	= calloc(aux + 1, sizeof(float));
+  e->level	= calloc(cells + 1, 1);
+  e->shown	= malloc(cells + 1);
+  e->hit	= malloc((width > star_count(e) ? width : star_count(e)) * sizeof(struct hitEx));
+  if(e->v == NULL || e->aux == NULL || e->level == NULL || e->shown == NULL ||
+     e->hit == NULL){
+    effect_free(e);
+    return NULL;
+  }
+  memset(e->shown, 255, cells);
+
+  switch(kind){
+  case EFFECT_PLASMA:
+    /* Distance from the center is fixed; do the square roots once */
+    for(y = 0; y < height; y++)
+      for(x = 0; x < width; x++){
+        dx = x - width / 2.0f;
+        dy = 2 * (y - height / 2.0f);	/* Cells are about twice as tall */
+        e->aux[y * width + x] = sqrt(dx * dx + dy * dy) * 0.12f;
+      }
+    break;
+  case EFFECT_MATRIX:
+    for(x = 0; x < width; x++){
+      e->aux[x]			= -random_float(e) * height;
+      e->aux[width + x]		= 0.3f + random_float(e) * 0.7f;
+      e->aux[2 * width + x]	= random_float(e) * 1000;
+    }
+    break;
+  case EFFECT_STARFIELD:
+    for(x = 0; x < star_count(e); x++)
+      star_reset(e, &e->aux[3 * x], 0.05f + random_float(e));
+    break;
+  }
+
+  return e;
+}
+
+void effect_free(struct effectEx *e){
+  if(e == NULL)
+    return;
+
+  free(e->v);
+  free(e->aux);
+  free(e->level);
+  free(e->shown);
+  free(e->hit);
+  free(e);
+}
+
+/* Hits are the few cells the scalar part lights up; they are applied by
+ * the row pass, after the decay */
+static void hit(struct effectEx *e, int offset, float value){
+  e->hit[e->hit_count].offset = offset;
+  e->hit[e->hit_count].value = value;
+  e->hit_count++;
+}
+
+static void prepare_plasma(struct effectEx *e){
+  float *col = &e->aux[e->width * e->height];
+  float *xc = &col[e->width];
+  int x;
+
+  for(x = 0; x < e->width; x++){
+    col[x] = sin_scalar(x * 0.09f + e->t) + sin_scalar(x * 0.023f - e->t * 0.4f);
+    xc[x] = x * 0.05f;
+  }
+}
+
+static void prepare_matrix(struct effectEx *e){
+  float *head = e->aux;
+  float *speed = &e->aux[e->width];
+  float *glyph = &e->aux[2 * e->width];
+  int x, y;
+
+  for(x = 0; x < e->width; x++){
+    head[x] += speed[x];
+    y = (int)head[x];
+    if(y >= 0 && y < e->height)
+      hit(e, y * e->width + x, 1.0f);
+    if(y >= e->height + 20){
+      head[x] = -random_float(e) * e->height;
+      speed[x] = 0.3f + random_float(e) * 0.7f;
+      glyph[x] = random_float(e) * 1000;
+    }
+  }
+}
+
+static void prepare_starfield(struct effectEx *e){
+  float *star;
+  int sx, sy;
+  int i;
+
+  for(i = 0; i < star_count(e); i++){
+    star = &e->aux[3 * i];
+    star[2] -= 0.015f;
+    if(star[2] <= 0.02f)
+      star_reset(e, star, 1.0f);
+
+    sx = (int)(star[0] / star[2] * e->width / 2 + e->width / 2);
+    sy = (int)(star[1] / star[2] * e->height / 2 + e->height / 2);
+    if(sx < 0 || sx >= e->width || sy < 0 || sy >= e->height){
+      star_reset(e, star, 1.0f);
+      continue;
+    }
+
+    hit(e, sy * e->width + sx, 1.0f - star[2]);
+  }
+}
+
+static float *fire_page(struct effectEx *e, int page){
+  return &e->aux[page * (e->width + 2) * (e->height + 2)];
+}
+
+static void prepare_fire(struct effectEx *e){
+  int stride = e->width + 2;
+  float *heat;
+  int x, y;
+
+  /* Last frame's output is this frame's input */
+  e->page ^= 1;
+  heat = fire_page(e, e->page);
+
+  /* Fuel: two hidden rows below the screen */
+  for(y = e->height; y < e->height + 2; y++)
+    for(x = 1; x <= e->width; x++)
+      heat[y * stride + x] = random_float(e) < 0.45f ? 1.3f : 0.0f;
+}
+
+/* Everything which has to happen in order: time, random numbers, moving
+ * stars and drops. Cheap. */
+void effect_prepare(struct effectEx *e, double t){
+  e->t = (float)t;
+  e->hit_count = 0;
+
+  switch(e->kind){
+  case EFFECT_PLASMA:	prepare_plasma(e); break;
+  case EFFECT_MATRIX:	prepare_matrix(e); break;
+  case EFFECT_STARFIELD:	prepare_starfield(e); break;
+  case EFFECT_FIRE:	prepare_fire(e); break;
+  }
+
+  e->frame++;
+}
+
+/* The per-cell work for rows [first, last). Rows only depend on what
+ * effect_prepare() left behind, so any split of the rows over any number
+ * of threads gives the same levels. */
+void effect_rows(struct effectEx *e, int first, int last){
+  struct kernelsEx *k = &kernels[e->path];
+  float *col, *heat, *next;
+  float *v;
+  int stride;
+  int i, y;
+
+  switch(e->kind){
+  case EFFECT_PLASMA:
+    col = &e->aux[e->width * e->height];
+    for(y = first; y < last; y++)
+      k->plasma(&e->v[y * e->width], &e->aux[y * e->width], col, &col[e->width],
+                sin_scalar(y * 0.15f + e->t * 1.3f) + sin_scalar(y * 0.041f - e->t * 0.3f),
+                y * 0.1f + e->t * 0.7f, e->t * 1.7f, e->width);
+    break;
+
+  case EFFECT_MATRIX:
+  case EFFECT_STARFIELD:
+    k->decay(&e->v[first * e->width], (last - first) * e->width,
+             e->kind == EFFECT_MATRIX ? MATRIX_DECAY : STAR_DECAY);
+    for(i = 0; i < e->hit_count; i++)
+      if(e->hit[i].offset >= first * e->width && e->hit[i].offset < last * e->width){
+        v = &e->v[e->hit[i].offset];
+        if(*v < e->hit[i].value)
+          *v = e->hit[i].value;
+      }
+    break;
+
+  case EFFECT_FIRE:
+    stride = e->width + 2;
+    heat = fire_page(e, e->page);
+    next = fire_page(e, e->page ^ 1);
+    for(y = first; y < last; y++){
+      k->fire(&next[y * stride + 1], &heat[(y + 1) * stride + 1],
+              &heat[(y + 2) * stride + 1], e->width);
+      k->quantize(&next[y * stride + 1], &e->level[y * e->width], e->width);
+    }
+    return;
+  }
+
+  k->quantize(&e->v[first * e->width], &e->level[first * e->width],
+              (last - first) * e->width);
+}
+
+void effect_step(struct effectEx *e, double t){
+  effect_prepare(e, t);
+  effect_rows(e, 0, e->height);
+}
+
+/* Something else drew over these cells; draw them again next time */
+void effect_dirty(struct effectEx *e, int x, int y, int w, int h){
+  int r;
+
+  if(x < 0){
+    w += x;
+    x = 0;
+  }
+  if(y < 0){
+    h += y;
+    y = 0;
+  }
+  if(x + w > e->width)
+    w = e->width - x;
+  if(y + h > e->height)
+    h = e->height - y;
+
+  for(r = y; r < y + h && w > 0; r++)
+    memset(&e->shown[r * e->width + x], 255, w);
+}
+
+int effect_glyph(struct effectEx *e, int level, int x, int y){
+  if(e->kind == EFFECT_MATRIX){
+    if(level == 0)
+      return ' ';
+    return matrix_chars[(x * 31 + y * 17 + (int)e->aux[2 * e->width + x])
+                        % (sizeof(matrix_chars) - 1)];
+  }
+
+  return ramp[e->kind][level];
+}
+
+int effect_color(struct effectEx *e, int level){
+  return pairs[e->kind][level];
+}
+
+/* Cells per second for every effect and kernel flavour */
+void effect_bench(int width, int height){
+  struct effectEx *e;
+  double begin, elapsed;
+  long steps;
+  int kind;
+  int path;
+
+  printf("Effect kernels, %dx%d cells, million cells per second:\n\n", width, height);
+  printf("%-12s", "");
+  for(path = 0; path < EFFECT_PATHS; path++)
+    printf("%10s", path_names[path]);
+  printf("\n");
+
+  for(kind = 0; kind < EFFECT_COUNT; kind++){
+    printf("%-12s", names[kind]);
+    for(path = 0; path < EFFECT_PATHS; path++){
+      if(!path_available(path)){
+        printf("%10s", "-");
+        continue;
+      }
+      e = effect_new(kind, width, height, path);
+      if(e == NULL){
+        printf("%10s", "nomem");
+        continue;
+      }
+      effect_step(e, 0);
+      steps = 0;
+      begin = tickcount();
+      do{
+        effect_step(e, steps * 0.05);
+        steps++;
+        elapsed = tickcount() - begin;
+      }while(elapsed < 0.25);
+      printf("%10.1f", steps * (double)width * height / elapsed / 1000000);
+      fflush(stdout);
+      effect_free(e);
+    }
+    printf("\n");
+  }
+
+  printf("\nBest available: %s\n", path_names[effect_best_path()]);
+}
@@ -0,0 +1,68 @@
+/* Terminal ScreenSaver - full screen effects
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Effects run a kernel over a flat buffer of intensities (0 - 1), one
+ * float per cell, and quantize it to a level per cell. The levels are then
+ * turned in to a character and one of the eight classic color pairs. The
+ * kernels have SSE2 and AVX2 versions besides the plain C one.
+ */
+
+#ifndef TSS_EFFECT_H
+#define TSS_EFFECT_H
+
+#define EFFECT_PLASMA		0
+#define EFFECT_MATRIX		1
+#define EFFECT_STARFIELD	2
+#define EFFECT_FIRE		3
+#define EFFECT_COUNT		4
+
+#define EFFECT_LEVELS		16
+
+#define EFFECT_SCALAR		0
+#define EFFECT_SSE2		1
+#define EFFECT_AVX2		2
+#define EFFECT_PATHS		3
+
+struct hitEx{
+  int offset;
+  float value;
+};
+
+struct effectEx{
+  int kind;
+  int width;
+  int height;
+  int path;			/* EFFECT_SCALAR, _SSE2 or _AVX2 */
+  float *v;			/* width * height intensities */
+  float *aux;			/* Per kind scratch */
+  unsigned char *level;		/* width * height quantized */
+  unsigned char *shown;		/* Level on screen, 255 for unknown */
+  struct hitEx *hit;		/* Cells lit this frame */
+  int hit_count;
+  int page;			/* Fire: which half of aux is input */
+  float t;			/* Seconds, as given to effect_prepare() */
+  unsigned int seed;
+  long frame;
+};
+
+int effect_find(const char *name);
+const char *effect_name(int kind);
+int effect_best_path(void);
+
+struct effectEx *effect_new(int kind, int width, int height, int path);
+void effect_free(struct effectEx *e);
+void effect_prepare(struct effectEx *e, double t);
+void effect_rows(struct effectEx *e, int first, int last);
+void effect_step(struct effectEx *e, double t);
+void effect_dirty(struct effectEx *e, int x, int y, int w, int h);
+int effect_glyph(struct effectEx *e, int level, int x, int y);
+int effect_color(struct effectEx *e, int level);
+
+void effect_bench(int width, int height);
+
+#endif
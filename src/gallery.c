@@ -0,0 +1,189 @@
+/* Terminal ScreenSaver - ascii gallery
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * Ascii which fits is shown as it is. Bigger ascii is shrunk by the same
+ * factor both ways; each character of the picture stands for a block of
+ * the original and shows the visible character nearest the middle of
+ * that block, so outlines survive better than with plain sampling.
+ *
+ * */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gallery.h"
+
+struct galleryEx *gallery_new(char **file, int count){
+  struct galleryEx *g;
+
+  g = calloc(1, sizeof(struct galleryEx));
+  if(g == NULL)
+    return NULL;
+
+  g->count	= count;
+  g->file	= file;
+  g->thumb	= calloc(count + 1, sizeof(struct thumbEx *));
+  if(g->thumb == NULL){
+    free(g);
+    return NULL;
+  }
+
+  return g;
+}
+
+void gallery_free(struct galleryEx *g){
+  int i;
+
+  if(g == NULL)
+    return;
+
+  for(i = 0; i < g->count; i++)
+    free(g->thumb[i]);
+  free(g->thumb);
+  free(g);
+}
+
+/* The visible cell of [art] in the block [x0] - [x1], [y0] - [y1] which is
+ * nearest its middle; NULL if it is all blank */
+static struct cellEx *pick(struct artEx *art, int x0, int y0, int x1, int y1){
+  struct cellEx *cell;
+  struct cellEx *best;
+  long distance, best_distance;
+  int cx, cy;
+  int x, y;
+
+  /* A picture rounded up to one cell can ask for more than there is */
+  if(x1 > art->width)
+    x1 = art->width;
+  if(y1 > art->height)
+    y1 = art->height;
+  if(x0 >= x1 || y0 >= y1)
+    return NULL;
+
+  cx = x0 + x1;			/* Twice the middle; saves the halving */
+  cy = y0 + y1;
+  best = NULL;
+  best_distance = 0;
+
+  for(y = y0; y < y1; y++){
+    cell = &art->cell[ART_NORMAL][y * art->width + x0];
+    for(x = x0; x < x1; x++, cell++){
+      if(cell->ch == ' ' || cell->width == 0)
+        continue;
+      distance = (long)(2 * x + 1 - cx) * (2 * x + 1 - cx) +
+                 (long)(2 * y + 1 - cy) * (2 * y + 1 - cy);
+      if(best == NULL || distance < best_distance){
+        best = cell;
+        best_distance = distance;
+      }
+    }
+  }
+
+  return best;
+}
+
+static void shrink(struct thumbEx *t, struct artEx *art){
+  struct cellEx *from;
+  struct cellEx blank;
+  double scale, scale_y;
+  int x, y, i;
+
+  blank.ch	= ' ';
+  blank.color	= art->tail_color;
+  blank.width	= 1;
+
+  if(art->width <= GALLERY_THUMB_WIDTH && art->height <= GALLERY_THUMB_HEIGHT){
+    t->width	= art->width;
+    t->height	= art->height;
+    scale	= 1;
+  }else{
+    scale	= (double)art->width / GALLERY_THUMB_WIDTH;
+    scale_y	= (double)art->height / GALLERY_THUMB_HEIGHT;
+    if(scale_y > scale)
+      scale	= scale_y;
+    t->width	= art->width / scale;
+    t->height	= art->height / scale;
+    if(t->width < 1)
+      t->width = 1;
+    if(t->height < 1)
+      t->height = 1;
+  }
+
+  for(y = 0; y < t->height; y++)
+    for(x = 0; x < t->width; x++){
+      i = y * t->width + x;
+      if(scale == 1){
+        from = &art->cell[ART_NORMAL][y * art->width + x];
+      }else{
+        from = pick(art, x * scale, y * scale, (x + 1) * scale, (y + 1) * scale);
+        if(from == NULL)
+          from = &blank;
+      }
+
+      t->cell[i] = *from;
+      /* A shrunk wide character would need its other half */
+      if(scale != 1 && from->width != 1){
+        t->cell[i].ch = '#';
+        t->cell[i].width = 1;
+      }
+      t->color[i] = art->palette[from->color];
+    }
+}
+
+/* The picture for file [index], read now if it hasn't been yet */
+struct thumbEx *gallery_thumb(struct galleryEx *g, int index){
+  char error[ART_ERROR_SIZE];
+  struct artEx *art;
+  struct thumbEx *t;
+
+  if(index < 0 || index >= g->count)
+    return NULL;
+  if(g->thumb[index] != NULL)
+    return g->thumb[index];
+
+  t = calloc(1, sizeof(struct thumbEx));
+  if(t == NULL)
+    return NULL;
+
+  /* Unreadable files get an empty picture, so they are only tried once */
+  art = art_load(g->file[index], 0, error);
+  if(art != NULL){
+    t->art_width	= art->width;
+    t->art_height	= art->height;
+    t->frames		= art->frame_count;
+    shrink(t, art);
+    art_free(art);
+  }
+
+  g->thumb[index] = t;
+  g->built++;
+  return t;
+}
+
+/* Make one picture of files [first] .. [first] + [count] - 1 which isn't
+ * there yet, for when nothing else is going on. 0 when all were there. */
+int gallery_prefetch(struct galleryEx *g, int first, int count){
+  int i;
+
+  for(i = first; i < first + count && i < g->count; i++)
+    if(i >= 0 && g->thumb[i] == NULL)
+      return gallery_thumb(g, i) != NULL;
+
+  return 0;
+}
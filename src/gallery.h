@@ -0,0 +1,45 @@
+/* Terminal ScreenSaver - ascii gallery
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * --gallery shows the ascii directory as a grid of small pictures. A file
+ * is only read once its picture is wanted, and the picture is kept, so
+ * going back to a page costs nothing. The pictures carry their own
+ * colors; the ascii they were made from is freed right away.
+ */
+
+#ifndef TSS_GALLERY_H
+#define TSS_GALLERY_H
+
+#include "art.h"
+
+#define GALLERY_THUMB_WIDTH	24
+#define GALLERY_THUMB_HEIGHT	8
+
+struct thumbEx{
+  int width;			/* 0 if the file could not be read */
+  int height;
+  int art_width;		/* Of the ascii itself */
+  int art_height;
+  int frames;
+  struct cellEx cell[GALLERY_THUMB_WIDTH * GALLERY_THUMB_HEIGHT];
+  struct paletteEx color[GALLERY_THUMB_WIDTH * GALLERY_THUMB_HEIGHT];
+};
+
+struct galleryEx{
+  int count;
+  char **file;			/* Not ours */
+  struct thumbEx **thumb;	/* NULL until wanted */
+  int built;
+};
+
+struct galleryEx *gallery_new(char **file, int count);
+void gallery_free(struct galleryEx *g);
+struct thumbEx *gallery_thumb(struct galleryEx *g, int index);
+int gallery_prefetch(struct galleryEx *g, int first, int count);
+
+#endif
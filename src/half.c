@@ -0,0 +1,210 @@
+/* Terminal ScreenSaver - half block ascii
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * Pixel rows 2r and 2r + 1 are character row r of the ascii. A cell of
+ * row r standing in phase p shows pixel rows 2r - p (top) and 2r + 1 - p
+ * (bottom), so phase 1 is the same picture half a row lower, with an
+ * extra row at the bottom; phase 0 leaves that row blank.
+ *
+ * A character shows its foreground color, a space its background; black
+ * is the background of the screen, and is left empty. Cells need a
+ * palette entry for every pair of colors that meet in them, which the
+ * ascii's own palette can't take (it may be shared, see share.h), so the
+ * pictures get one of their own, starting with the classic colors.
+ *
+ * */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "half.h"
+
+#define BACKGROUND		0
+
+/* Palette entry for [fg] on [bg], added if it is new */
+static int color(struct halfEx *h, long fg, long bg){
+  struct paletteEx *palette;
+  int *chain;
+  int size;
+  int k;
+  int i;
+
+  if(bg == BACKGROUND && fg >= 0 && fg < ART_LEGACY_COLORS)
+    return fg + 1;
+
+  k = (int)(((unsigned long)fg * 31 + (unsigned long)bg * 131) % HALF_HASH);
+  for(i = h->hash[k]; i != 0; i = h->chain[i])
+    if(h->palette[i].fg == fg && h->palette[i].bg == bg)
+      return i;
+
+  if(h->palette_count >= ART_MAX_COLORS)
+    return ART_DEFAULT_COLOR;
+
+  if(h->palette_count == h->palette_size){
+    size = h->palette_size * 2;
+    palette = realloc(h->palette, size * sizeof(struct paletteEx));
+    if(palette == NULL)
+      return -1;
+    h->palette = palette;
+    chain = realloc(h->chain, size * sizeof(int));
+    if(chain == NULL)
+      return -1;
+    h->chain = chain;
+    h->palette_size = size;
+  }
+
+  i = h->palette_count++;
+  h->palette[i].fg = fg;
+  h->palette[i].bg = bg;
+  h->chain[i] = h->hash[k];
+  h->hash[k] = i;
+
+  return i;
+}
+
+/* The cell showing [top] over [bottom] */
+static int pair(struct halfEx *h, struct cellEx *cell, long top, long bottom){
+  int c;
+
+  cell->width = 1;
+  if(top == bottom){
+    cell->ch = top == BACKGROUND ? ' ' : HALF_FULL;
+    c = color(h, top == BACKGROUND ? ART_DEFAULT_COLOR - 1 : top, BACKGROUND);
+  }else if(bottom == BACKGROUND){
+    cell->ch = HALF_UPPER;
+    c = color(h, top, BACKGROUND);
+  }else if(top == BACKGROUND){
+    cell->ch = HALF_LOWER;
+    c = color(h, bottom, BACKGROUND);
+  }else{
+    cell->ch = HALF_UPPER;
+    c = color(h, top, bottom);
+  }
+
+  if(c == -1)
+    return -1;
+  cell->color = c;
+  return 0;
+}
+
+/* Pixel row [k] of the picture, as colors; NULL outside of it */
+static long *pixel_row(struct halfEx *h, int k, int rows){
+  if(k < 0 || k >= 2 * rows)
+    return NULL;
+  return &h->pixel[(k / 2) * h->width];
+}
+
+static int build_orient(struct halfEx *h, struct artEx *art, struct cellEx *grid, int orient){
+  struct paletteEx *p;
+  struct cellEx *cell;
+  long *top, *bottom;
+  long previous;
+  int rows;
+  int phase;
+  int x, y;
+  int i;
+
+  /* A color per character; the right half of a wide one is the left */
+  rows = h->height - 1;
+  previous = BACKGROUND;
+  for(i = 0; i < h->width * rows; i++){
+    if(grid[i].width != 0){
+      p = &art->palette[grid[i].color];
+      previous = grid[i].ch != ' ' ? p->fg : p->bg;
+    }
+    h->pixel[i] = previous;
+  }
+
+  for(phase = 0; phase < HALF_PHASES; phase++){
+    cell = h->cell[orient][phase];
+    for(y = 0; y < h->height; y++){
+      top = pixel_row(h, 2 * y - phase, rows);
+      bottom = pixel_row(h, 2 * y + 1 - phase, rows);
+      for(x = 0; x < h->width; x++, cell++)
+        if(pair(h, cell, top ? top[x] : BACKGROUND, bottom ? bottom[x] : BACKGROUND) == -1)
+          return -1;
+    }
+  }
+
+  return 0;
+}
+
+/* Make the pictures again from [grid], after the ascii went to another
+ * frame. -1 when out of memory. */
+int half_build(struct halfEx *h, struct artEx *art, struct cellEx **grid){
+  int o;
+
+  for(o = 0; o < ART_ORIENTS; o++)
+    if(h->cell[o][0] != NULL && build_orient(h, art, grid[o], o) == -1)
+      return -1;
+  return 0;
+}
+
+/* Pictures of every orientation in [grid] */
+struct halfEx *half_new(struct artEx *art, struct cellEx **grid){
+  struct halfEx *h;
+  long cells;
+  int o, phase;
+
+  h = calloc(1, sizeof(struct halfEx));
+  if(h == NULL)
+    return NULL;
+
+  h->width		= art->width;
+  h->height		= art->height + 1;
+  h->palette_size	= ART_LEGACY_COLORS + 1;
+  h->palette_count	= h->palette_size;
+  h->palette		= malloc(h->palette_size * sizeof(struct paletteEx));
+  h->chain		= calloc(h->palette_size, sizeof(int));
+  h->pixel		= malloc((long)art->width * art->height * sizeof(long));
+  if(h->palette == NULL || h->chain == NULL || h->pixel == NULL)
+    goto fail;
+  memcpy(h->palette, art->palette, h->palette_size * sizeof(struct paletteEx));
+
+  cells = (long)h->width * h->height;
+  for(o = 0; o < ART_ORIENTS; o++)
+    for(phase = 0; phase < HALF_PHASES && grid[o] != NULL; phase++){
+      h->cell[o][phase] = malloc(cells * sizeof(struct cellEx));
+      if(h->cell[o][phase] == NULL)
+        goto fail;
+    }
+
+  if(half_build(h, art, grid) == -1)
+    goto fail;
+  return h;
+
+fail:
+  half_free(h);
+  return NULL;
+}
+
+void half_free(struct halfEx *h){
+  int o, phase;
+
+  if(h == NULL)
+    return;
+
+  for(o = 0; o < ART_ORIENTS; o++)
+    for(phase = 0; phase < HALF_PHASES; phase++)
+      free(h->cell[o][phase]);
+  free(h->palette);
+  free(h->chain);
+  free(h->pixel);
+  free(h);
+}
@@ -0,0 +1,45 @@
+/* Terminal ScreenSaver - half block ascii
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * With --half-blocks the ascii is drawn as a picture instead of as text:
+ * every character becomes a block of its color two "pixels" high, and
+ * each cell of the terminal shows two pixels with the upper and lower
+ * half block characters. The ascii can then also stand half a row lower
+ * than a row, so it moves up and down in steps half as big. Both ways of
+ * standing are made when the ascii is loaded, so drawing only copies
+ * cells, as for text.
+ */
+
+#ifndef TSS_HALF_H
+#define TSS_HALF_H
+
+#include "art.h"
+
+#define HALF_PHASES		2	/* Standing on a row, half a row lower */
+#define HALF_UPPER		0x2580
+#define HALF_LOWER		0x2584
+#define HALF_FULL		0x2588
+#define HALF_HASH		1024
+
+struct halfEx{
+  int width;
+  int height;			/* One row more than the ascii */
+  struct cellEx *cell[ART_ORIENTS][HALF_PHASES];	/* NULL if not built */
+  struct paletteEx *palette;	/* Entries 0 - 8 as in the ascii */
+  int palette_count;
+  int palette_size;
+  int hash[HALF_HASH];
+  int *chain;
+  long *pixel;			/* Scratch, a color per character */
+};
+
+struct halfEx *half_new(struct artEx *art, struct cellEx **grid);
+int half_build(struct halfEx *h, struct artEx *art, struct cellEx **grid);
+void half_free(struct halfEx *h);
+
+#endif
@@ -0,0 +1,381 @@
+/* Terminal ScreenSaver - image importer
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * The picture is read one pixel row at a time and added in to a row of
+ * per-sample sums, so even a huge photo only ever needs a couple of rows
+ * in memory. Once a band of rows is summed, each block of columns is
+ * totalled and becomes a character.
+ *
+ * Reads P2, P3 (plain) and P5, P6 (raw, 8 or 16 bit) files.
+ *
+ * */
+
+#define _XOPEN_SOURCE	500
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef __SSE2__
+ #include <emmintrin.h>
+#endif
+
+#include "import.h"
+
+#define CACHE_PATH		512
+
+static const char ramp[] = " .:-=+*#%@";
+
+/* ESC 1 .. ESC 8; 1 (black) is never picked */
+static const unsigned char classic[8][3] = {
+  {  0,   0,   0}, {255,   0,   0}, {  0, 255,   0}, {255, 255,   0},
+  {  0,   0, 255}, {255,   0, 255}, {  0, 255, 255}, {255, 255, 255}
+};
+
+struct pnmEx{
+  FILE *fd;
+  int width;
+  int height;
+  int channels;			/* 1 for PGM, 3 for PPM */
+  int maxval;
+  short plain;			/* Numbers in text */
+  unsigned char *raw;		/* 16 bit rows */
+};
+
+/* Next number in the header or a plain file; -1 on garbage or EOF */
+static long number(FILE *fd){
+  long value;
+  int c;
+
+  do{
+    c = fgetc(fd);
+    if(c == '#')
+      while(c != '\n' && c != EOF)
+        c = fgetc(fd);
+  }while(c == ' ' || c == '\t' || c == '\r' || c == '\n');
+
+  if(c < '0' || c > '9')
+    return -1;
+
+  value = 0;
+  while(c >= '0' && c <= '9' && value < 100000000){
+    value = value * 10 + c - '0';
+    c = fgetc(fd);
+  }
+
+  /* The one whitespace after the header is eaten here, as it should be */
+  return value;
+}
+
+static int pnm_open(struct pnmEx *p, const char *file_name, char *error){
+  int magic;
+
+  memset(p, 0, sizeof(struct pnmEx));
+
+  p->fd = fopen(file_name, "rb");
+  if(p->fd == NULL){
+    sprintf(error, "\"%.512s\" could not be read: %s\n", file_name, strerror(errno));
+    return -1;
+  }
+
+  magic = fgetc(p->fd) == 'P' ? fgetc(p->fd) : 0;
+  switch(magic){
+  case '2': p->channels = 1; p->plain = 1; break;
+  case '3': p->channels = 3; p->plain = 1; break;
+  case '5': p->channels = 1; break;
+  case '6': p->channels = 3; break;
+  default:
+    sprintf(error, "\"%.512s\" is not a PPM or PGM file.\n", file_name);
+    fclose(p->fd);
+    return -1;
+  }
+
+  p->width = number(p->fd);
+  p->height = number(p->fd);
+  p->maxval = number(p->fd);
+  if(p->width < 1 || p->height < 1 || p->maxval < 1 || p->maxval > 65535){
+    sprintf(error, "\"%.512s\" has a broken header.\n", file_name);
+    fclose(p->fd);
+    return -1;
+  }
+
+  if(!p->plain && p->maxval > 255){
+    p->raw = malloc((long)p->width * p->channels * 2);
+    if(p->raw == NULL){
+      sprintf(error, "Out of memory.\n");
+      fclose(p->fd);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static void pnm_close(struct pnmEx *p){
+  fclose(p->fd);
+  free(p->raw);
+}
+
+/* One row of samples, 8 bit. Raw 8 bit rows are left as they are (scaled
+ * later, by top()); everything else is scaled to 0 - 255 here. */
+static int pnm_row(struct pnmEx *p, unsigned char *row){
+  long n = (long)p->width * p->channels;
+  long value;
+  long i;
+
+  if(p->plain){
+    for(i = 0; i < n; i++){
+      value = number(p->fd);
+      if(value < 0)
+        return -1;
+      row[i] = (value > p->maxval ? p->maxval : value) * 255 / p->maxval;
+    }
+  }else if(p->raw != NULL){
+    if(fread(p->raw, 2, n, p->fd) != (size_t)n)
+      return -1;
+    for(i = 0; i < n; i++)
+      row[i] = (p->raw[2 * i] << 8 | p->raw[2 * i + 1]) * 255L / p->maxval;
+  }else{
+    if(fread(row, 1, n, p->fd) != (size_t)n)
+      return -1;
+  }
+
+  return 0;
+}
+
+/* What a full sample is worth in the rows pnm_row() gave us */
+static int top(struct pnmEx *p){
+  return p->plain || p->raw != NULL ? 255 : p->maxval;
+}
+
+/* sum[i] += row[i] */
+static void accumulate(unsigned int *sum, const unsigned char *row, long n){
+  long i = 0;
+#ifdef __SSE2__
+  __m128i zero = _mm_setzero_si128();
+  __m128i v, lo, hi;
+  __m128i *s;
+
+  for(; i + 16 <= n; i += 16){
+    v = _mm_loadu_si128((const __m128i *)&row[i]);
+    lo = _mm_unpacklo_epi8(v, zero);
+    hi = _mm_unpackhi_epi8(v, zero);
+    s = (__m128i *)&sum[i];
+    _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_unpacklo_epi16(lo, zero)));
+    _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), _mm_unpackhi_epi16(lo, zero)));
+    _mm_storeu_si128(s + 2, _mm_add_epi32(_mm_loadu_si128(s + 2), _mm_unpacklo_epi16(hi, zero)));
+    _mm_storeu_si128(s + 3, _mm_add_epi32(_mm_loadu_si128(s + 3), _mm_unpackhi_epi16(hi, zero)));
+  }
+#endif
+  for(; i < n; i++)
+    sum[i] += row[i];
+}
+
+/* Nearest classic color to the hue of [rgb]; brightness is the glyph's job */
+static int nearest(int *rgb){
+  long best_distance, distance, d;
+  int max;
+  int best;
+  int i, c;
+
+  max = rgb[0] > rgb[1] ? rgb[0] : rgb[1];
+  max = rgb[2] > max ? rgb[2] : max;
+  if(max == 0)
+    return ART_DEFAULT_COLOR;
+
+  best = ART_DEFAULT_COLOR;
+  best_distance = -1;
+  for(i = 1; i < 8; i++){
+    distance = 0;
+    for(c = 0; c < 3; c++){
+      d = rgb[c] * 255 / max - classic[i][c];
+      distance += d * d;
+    }
+    if(best_distance == -1 || distance < best_distance){
+      best_distance = distance;
+      best = i + 1;
+    }
+  }
+
+  return best;
+}
+
+/* Convert [file_name] to the text of an ascii file, at most [columns]
+ * wide and [max_rows] high. Cells are taken to be twice as high as wide. */
+char *import_convert(const char *file_name, int columns, int max_rows,
+                     long *length, char *error){
+  struct pnmEx p;
+  unsigned int *sum;
+  unsigned char *row;
+  char *text, *t;
+  long total, n;
+  int rgb[3];
+  int rows;
+  int color;
+  int lum;
+  int x0, x1, y, band;
+  int r, c, i, k;
+
+  if(pnm_open(&p, file_name, error) == -1)
+    return NULL;
+
+  if(columns > p.width)
+    columns = p.width;
+  rows = ((long)columns * p.height + p.width) / (2L * p.width);
+  if(rows > max_rows){
+    rows = max_rows;
+    columns = 2L * rows * p.width / p.height;
+    if(columns > p.width)
+      columns = p.width;
+  }
+  if(rows > p.height)
+    rows = p.height;
+  if(rows < 1)
+    rows = 1;
+  if(columns < 1)
+    columns = 1;
+
+  n = (long)p.width * p.channels;
+  sum = malloc(n * sizeof(unsigned int));
+  row = malloc(n);
+  /* ESC n, then at most ESC + color + glyph per cell */
+  text = malloc(2 + (long)rows * (3 * columns + 1) + 1);
+  if(sum == NULL || row == NULL || text == NULL){
+    sprintf(error, "Out of memory.\n");
+    free(sum);
+    free(row);
+    free(text);
+    pnm_close(&p);
+    return NULL;
+  }
+
+  /* A picture is never turned around */
+  t = text;
+  *t++ = 27;
+  *t++ = 'n';
+
+  color = -1;
+  y = 0;
+  for(r = 0; r < rows; r++){
+    memset(sum, 0, n * sizeof(unsigned int));
+    for(band = 0; y < (long)(r + 1) * p.height / rows; y++, band++){
+      if(pnm_row(&p, row) == -1){
+        sprintf(error, "\"%.512s\" is cut short.\n", file_name);
+        free(sum);
+        free(row);
+        free(text);
+        pnm_close(&p);
+        return NULL;
+      }
+      accumulate(sum, row, n);
+    }
+
+    for(c = 0; c < columns; c++){
+      x0 = (long)c * p.width / columns;
+      x1 = (long)(c + 1) * p.width / columns;
+
+      for(i = 0; i < p.channels; i++){
+        total = 0;
+        for(k = x0; k < x1; k++)
+          total += sum[k * p.channels + i];
+        rgb[i] = total * 255.0 / ((double)(x1 - x0) * band * top(&p));
+      }
+      if(p.channels == 1)
+        rgb[1] = rgb[2] = rgb[0];
+
+      lum = (299 * rgb[0] + 587 * rgb[1] + 114 * rgb[2]) / 1000;
+      i = lum * (sizeof(ramp) - 1) / 256;
+
+      if(ramp[i] != ' ' && nearest(rgb) != color){
+        color = nearest(rgb);
+        *t++ = 27;
+        *t++ = '0' + color;
+      }
+      *t++ = ramp[i];
+    }
+    *t++ = '\n';
+  }
+
+  free(sum);
+  free(row);
+  pnm_close(&p);
+
+  *length = t - text;
+  return text;
+}
+
+/* The converted picture, from the cache next to it when that is as new as
+ * the picture itself */
+struct artEx *import_art(const char *file_name, int columns, int max_rows,
+                         int orients, char *error){
+  struct stat source;
+  struct stat cached;
+  struct utimbuf times;
+  struct artEx *art;
+  char cache[CACHE_PATH + 32];
+  char *text;
+  long length;
+  FILE *fd;
+  int ok;
+
+  if(stat(file_name, &source) == -1){
+    sprintf(error, "Cannot stat \"%.512s\": %s\n", file_name, strerror(errno));
+    return NULL;
+  }
+
+  cache[0] = 0;
+  if(strlen(file_name) < CACHE_PATH)
+    sprintf(cache, "%s.%dx%d.tss", file_name, columns, max_rows);
+
+  if(cache[0] != 0 && stat(cache, &cached) == 0 &&
+     S_ISREG(cached.st_mode) && cached.st_mtime == source.st_mtime){
+    art = art_load(cache, orients, error);
+    if(art != NULL)
+      return art;
+  }
+
+  text = import_convert(file_name, columns, max_rows, &length, error);
+  if(text == NULL)
+    return NULL;
+
+  art = art_parse(text, length, orients);
+  if(art == NULL)
+    sprintf(error, "\"%.512s\" could not be converted.\n", file_name);
+
+  /* Only a complete cache gets the picture's time; anything else is
+   * simply made again next time */
+  if(art != NULL && cache[0] != 0){
+    fd = fopen(cache, "wb");
+    if(fd != NULL){
+      ok = fwrite(text, 1, length, fd) == (size_t)length;
+      ok = fclose(fd) == 0 && ok;
+      times.actime = source.st_atime;
+      times.modtime = source.st_mtime;
+      if(!ok || utime(cache, &times) == -1)
+        remove(cache);
+    }
+  }
+
+  free(text);
+  return art;
+}
@@ -0,0 +1,27 @@
+/* Terminal ScreenSaver - image importer
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Turns a PPM or PGM picture in to a colored ascii file: every block of
+ * pixels becomes one character, picked by brightness, in the nearest of
+ * the eight classic colors. The result is saved next to the picture and
+ * reused for as long as the picture's modification time stays the same.
+ */
+
+#ifndef TSS_IMPORT_H
+#define TSS_IMPORT_H
+
+#include "art.h"
+
+#define IMPORT_ERROR_SIZE	ART_ERROR_SIZE
+
+struct artEx *import_art(const char *file_name, int columns, int max_rows,
+                         int orients, char *error);
+char *import_convert(const char *file_name, int columns, int max_rows,
+                     long *length, char *error);
+
+#endif
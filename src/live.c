@@ -0,0 +1,199 @@
+/* Terminal ScreenSaver - live labels
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * How often a label changes follows from its format: %S, %T and the
+ * like and {uptime} change every second, {load} every five (as often as
+ * the kernel works it out), any other time conversion every minute, and
+ * plain text and {host} never. Changes are due on whole periods of the
+ * clock, so a clock ticks over with the second and not some time after.
+ *
+ * {host} and {load} are put in before strftime() sees the format, with
+ * any % doubled, so they can't be taken for conversions.
+ *
+ * */
+
+#define _DEFAULT_SOURCE			/* getloadavg() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/utsname.h>
+
+#include "live.h"
+#include "tick.h"
+
+#define EXPANDED_SIZE		(LIVE_SIZE * 2)
+
+static const char *tokens[] = {"{host}", "{uptime}", "{load}", NULL};
+static const long token_period[] = {0, 1, 5};
+
+/* The token [format] starts with, or -1 */
+static int token(const char *format){
+  int i;
+
+  for(i = 0; tokens[i] != NULL; i++)
+    if(strncmp(format, tokens[i], strlen(tokens[i])) == 0)
+      return i;
+  return -1;
+}
+
+static long shorter(long period, long other){
+  if(period == 0 || (other != 0 && other < period))
+    return other;
+  return period;
+}
+
+/* When the uptime was 0, from /proc/uptime; -1 if there is none */
+static double boot_time(void){
+  FILE *f;
+  double up;
+
+  f = fopen("/proc/uptime", "r");
+  if(f == NULL)
+    return -1;
+  if(fscanf(f, "%lf", &up) != 1)
+    up = -1;
+  fclose(f);
+
+  return up < 0 ? -1 : tickcount() - up;
+}
+
+/* 0 on success, -1 with a message in [error] */
+int live_parse(struct liveEx *l, const char *format, int limit, char *error){
+  const char *f;
+  int t;
+
+  if(strlen(format) >= LIVE_SIZE){
+    sprintf(error, "Label \"%.64s...\" is too long (max %d characters)\n",
+            format, LIVE_SIZE - 1);
+    return -1;
+  }
+
+  memset(l, 0, sizeof(struct liveEx));
+  strcpy(l->format, format);
+  l->limit	= limit < LIVE_SIZE ? limit : LIVE_SIZE - 1;
+  l->boot	= -1;
+  l->drawn_x	= -1;
+
+  for(f = format; *f != 0; f++){
+    if(*f == '%' && f[1] != 0){
+      f++;
+      if(*f == 'E' || *f == 'O')
+        f++;
+      if(*f == 0)
+        break;
+      if(strchr("sSTrcX+", *f) != NULL)
+        l->period = shorter(l->period, 1);
+      else if(strchr("%nt", *f) == NULL)
+        l->period = shorter(l->period, 60);
+    }else if(*f == '{'){
+      t = token(f);
+      if(t == -1){
+        sprintf(error, "Unknown %.32s in label (use {host}, {uptime} or {load})\n", f);
+        return -1;
+      }
+      l->period = shorter(l->period, token_period[t]);
+      f += strlen(tokens[t]) - 1;
+    }
+  }
+
+  if(strstr(format, "{uptime}") != NULL)
+    l->boot = boot_time();
+
+  return 0;
+}
+
+/* Append [from] to [to] (at [*at], [size] bytes), % doubled */
+static void put(char *to, int *at, int size, const char *from){
+  for(; *from != 0 && *at < size - 2; from++){
+    if(*from == '%')
+      to[(*at)++] = '%';
+    to[(*at)++] = *from;
+  }
+}
+
+static void expand(struct liveEx *l, char *to, double now){
+  struct utsname host;
+  double load[1];
+  char value[64];
+  const char *f;
+  long up;
+  int at;
+  int t;
+
+  at = 0;
+  for(f = l->format; *f != 0 && at < EXPANDED_SIZE - 2; f++){
+    t = *f == '{' ? token(f) : -1;
+    if(t == -1){
+      to[at++] = *f;
+      if(*f == '%' && f[1] != 0)
+        to[at++] = *++f;
+      continue;
+    }
+
+    if(t == 0){
+      strcpy(value, "?");
+      if(uname(&host) != -1)
+        sprintf(value, "%.63s", host.nodename);
+    }else if(t == 1){
+      strcpy(value, "?");
+      up = l->boot < 0 ? -1 : (long)(now - l->boot);
+      if(up >= 86400)
+        sprintf(value, "%ldd %ld:%02ld:%02ld", up / 86400, up / 3600 % 24,
+                up / 60 % 60, up % 60);
+      else if(up >= 0)
+        sprintf(value, "%ld:%02ld:%02ld", up / 3600, up / 60 % 60, up % 60);
+    }else{
+      strcpy(value, "?");
+      if(getloadavg(load, 1) == 1)
+        sprintf(value, "%.2f", load[0]);
+    }
+    put(to, &at, EXPANDED_SIZE, value);
+    f += strlen(tokens[t]) - 1;
+  }
+  to[at] = 0;
+}
+
+/* Make the text again if it is due; 1 if it changed */
+int live_update(struct liveEx *l, double now){
+  char expanded[EXPANDED_SIZE];
+  char text[LIVE_SIZE];
+  time_t clock;
+
+  if(l->next != 0 && (l->period == 0 || now < l->next))
+    return 0;
+
+  if(l->period > 0)
+    l->next = ((double)(long)(now / l->period) + 1) * l->period;
+  else
+    l->next = now;
+
+  expand(l, expanded, now);
+  clock = (time_t)now;
+  if(strftime(text, LIVE_SIZE, expanded, localtime(&clock)) == 0)
+    text[0] = 0;
+  text[l->limit] = 0;
+
+  if(strcmp(text, l->text) == 0)
+    return 0;
+  strcpy(l->text, text);
+  l->width = strlen(text);
+  return 1;
+}
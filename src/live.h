@@ -0,0 +1,47 @@
+/* Terminal ScreenSaver - live labels
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * --label adds a line of text which bounces around like the uname, but
+ * keeps itself up to date: a clock, the uptime, the load average. The
+ * text is only made again when it can have changed (every second for a
+ * clock with seconds, every minute without), and only the characters
+ * which then differ are drawn, so a ticking clock costs a digit or two a
+ * second.
+ */
+
+#ifndef TSS_LIVE_H
+#define TSS_LIVE_H
+
+#define LIVE_MAX		4
+#define LIVE_SIZE		128
+#define LIVE_ERROR_SIZE		256
+
+struct liveEx{
+  char format[LIVE_SIZE];	/* strftime() format, and {host} etc. */
+  char text[LIVE_SIZE];		/* Made from format */
+  int width;			/* Of text */
+  int limit;			/* Widest text allowed */
+  long period;			/* Seconds between changes, 0 for never */
+  double next;			/* When text can change next */
+  double boot;			/* For {uptime}; -1 if not known */
+
+  float x;
+  float y;
+  float direction_x;
+  float direction_y;
+  int max_x;
+  int max_y;
+  int drawn_x;			/* -1 if not on screen */
+  int drawn_y;
+  int drawn_width;
+};
+
+int live_parse(struct liveEx *l, const char *format, int limit, char *error);
+int live_update(struct liveEx *l, double now);
+
+#endif
@@ -34,9 +34,6 @@
  * 		- Floating point exception on init (Due to small termsize)
  * 		- Offset problem in random values
  *
- * THOUGHS:
- * 		- WARNING: "MAXLINES" used in non-line fashion(mirrorbuf)
- *
  * Changelog:
  *
  *      0.8.2
@@ -120,6 +117,8 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <errno.h>
+#include <locale.h>
+#include <langinfo.h>
 #include <syslog.h>
 #include <signal.h>
 #include <stdlib.h>
@@ -146,46 +145,121 @@
  #include <sys/consio.h>
 #endif
 
+#include "art.h"
+#include "rotate.h"
+#include "color.h"
+#include "utf8.h"
+#include "transform.h"
+#include "effect.h"
+#include "compose.h"
+#include "particle.h"
+#include "stats.h"
+#include "import.h"
+#include "metrics.h"
+#include "render.h"
+#include "corpus.h"
+#include "gallery.h"
+#include "wall.h"
+#include "watch.h"
+#include "share.h"
+#include "live.h"
+#include "half.h"
+#include "tick.h"
+
 #define VERSION			"0.8.2"
 #define DEFAULT_ASCII_DIR	"/etc/tss/"
 #define DEFAULT_ASCII		"default"
-#define MAX_ASCII_SIZE		1024000
 #define TIMEOUT			30
-#define MAXLINES		1024
 #define MAXPATH			512
 
 #define SCROLL_BOX_WIDTH	20
 
 #define UNAME			0
 #define INFO			1
+
+#define OPT_ROTATE		256
+#define OPT_MIRROR_MAP		257
+#define OPT_EFFECT		258
+#define OPT_BENCH		259
+#define OPT_THREADS		260
+#define OPT_TILES		261
+#define OPT_PARTICLES		262
+#define OPT_STATS		263
+#define OPT_IMPORT		264
+#define OPT_IMPORT_WIDTH	265
+#define OPT_TIME_STARTUP	266
+#define OPT_METRICS		267
+#define OPT_METRICS_READ	268
+#define OPT_RENDER_THREAD	269
+#define OPT_BENCH_ART		270
+#define OPT_GENERATE_ART	271
+#define OPT_GALLERY		272
+#define OPT_WALL		273
+#define OPT_WATCH		274
+#define OPT_NO_SCROLL_MOTION	275
+#define OPT_SHARE_ART		276
+#define OPT_LABEL		277
+#define OPT_LABEL_SPEED		278
+#define OPT_HALF_BLOCKS		279
+#define OPT_BENCH_MOTION	280
+
+#define SPARKS			12	/* Per bounce */
+#define GALLERY_GAP		2	/* Columns between pictures */
+#define MOTION_SIZE		32
+#define MOTION_BUFFER		4096
+#define BENCH_SECONDS		60	/* Of made up time per run */
+#define BENCH_SPEED		4	/* Rows (and columns) a second */
   
 int lock_delay;
 int failed_logins;
 int vfd;
 int screen_width;
 int screen_height;
-int current_color;
+int current_color;		/* Curses color pair in use */
+int utf8_output;
+int scroll_motion;		/* Move the ascii by scrolling it */
+int half_blocks;		/* Draw the ascii as a picture of half blocks */
+
+struct motionEx{
+  char *csr;			/* Terminfo strings */
+  char *cup;
+  char *ri;
+  char *ind;
+  char ich[MOTION_SIZE];	/* One character, expanded */
+  char dch[MOTION_SIZE];
+  char buffer[MOTION_BUFFER];	/* One shift_object() */
+  int length;
+} motion;
 
-FILE *fd_ascii;
-  
 static char username[40];
 static char userpass[200];
 
-char mirrorchr[2][15];
 char *scroll_buffer;
   
 glob_t list;
 
 struct vt_mode ovtm;
 struct termios oterm;
+struct vt_mode vtm;		/* While locked */
+struct termios term;
 
 static sigset_t osig;
+static sigset_t sig;
+
+pid_t watch_pgrp;		/* Foreground before --watch took over, or -1 */
+pid_t watch_shell;		/* Foreground when tss ... & started, or -1 */
 
 struct ascii_objEx{
-  char *data;
-  char *line[MAXLINES];
-  char *blank[MAXLINES];
-  char mirror[MAXLINES];
+  char *blank;
+  struct artEx *art;
+  struct cellEx *grid[ART_ORIENTS];
+  int orient;
+  int frame;
+  double frame_begin;
+  int drawn_x;
+  int drawn_y;
+  int drawn_orient;
+  int drawn_phase;		/* Half a row lower, with --half-blocks */
   float x;
   float y;
   int max_x;
@@ -194,12 +268,25 @@ struct ascii_objEx{
   float direction_y;
   float speed;
   int width;
-  int width_real;
-  int height;
+  int height;			/* One more with --half-blocks */
+  struct halfEx *half;		/* NULL unless --half-blocks was given */
 } ascii_obj;
 
+struct effectEx *effect;		/* NULL unless an effect replaces the ascii */
+struct composeEx *compose;	/* NULL unless --threads was given */
+struct particlesEx *particles;	/* NULL unless --particles was given */
+struct statsEx stats;
+struct phasesEx phases;
+struct metricsEx *metrics;	/* NULL unless --metrics was given */
+struct renderEx *render;		/* NULL unless --render-thread was given */
+struct wallEx *wall;			/* NULL unless --wall was given */
+struct liveEx live[LIVE_MAX];		/* --label */
+int live_count;
+
 static struct option const long_options[] = {
     {"no-mirror", no_argument, NULL, 'n'},
+    {"flip", no_argument, NULL, 'f'},
+    {"mirror-map", required_argument, NULL, OPT_MIRROR_MAP},
     {"scrollbar", no_argument, NULL, 's'},
     {"random", no_argument, NULL, 'r'},
     {"lock-terminal", no_argument, NULL, 'l'},
@@ -208,6 +295,30 @@ static struct option const long_options[] = {
     {"object-speed", required_argument, NULL, 'o'},
     {"uname-speed", required_argument, NULL, 'e'},
     {"info-speed", required_argument, NULL, 'i'},
+    {"rotate", required_argument, NULL, OPT_ROTATE},
+    {"effect", required_argument, NULL, OPT_EFFECT},
+    {"bench", no_argument, NULL, OPT_BENCH},
+    {"threads", required_argument, NULL, OPT_THREADS},
+    {"tiles", required_argument, NULL, OPT_TILES},
+    {"particles", optional_argument, NULL, OPT_PARTICLES},
+    {"stats", no_argument, NULL, OPT_STATS},
+    {"import", required_argument, NULL, OPT_IMPORT},
+    {"import-width", required_argument, NULL, OPT_IMPORT_WIDTH},
+    {"time-startup", no_argument, NULL, OPT_TIME_STARTUP},
+    {"metrics", required_argument, NULL, OPT_METRICS},
+    {"metrics-read", required_argument, NULL, OPT_METRICS_READ},
+    {"render-thread", no_argument, NULL, OPT_RENDER_THREAD},
+    {"bench-art", no_argument, NULL, OPT_BENCH_ART},
+    {"generate-art", required_argument, NULL, OPT_GENERATE_ART},
+    {"gallery", no_argument, NULL, OPT_GALLERY},
+    {"wall", required_argument, NULL, OPT_WALL},
+    {"watch", required_argument, NULL, OPT_WATCH},
+    {"no-scroll-motion", no_argument, NULL, OPT_NO_SCROLL_MOTION},
+    {"share-art", no_argument, NULL, OPT_SHARE_ART},
+    {"label", required_argument, NULL, OPT_LABEL},
+    {"label-speed", required_argument, NULL, OPT_LABEL_SPEED},
+    {"half-blocks", no_argument, NULL, OPT_HALF_BLOCKS},
+    {"bench-motion", no_argument, NULL, OPT_BENCH_MOTION},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
     {NULL, 0, NULL, 0}
@@ -238,36 +349,38 @@ int getloadavg(double loadavg[], int nelem);
  void usleep(unsigned long usec);
 #endif
 
-long lof(FILE *fptr){
-  long old, new;
-  fseek(fptr, 0, SEEK_CUR);
-  old = ftell(fptr);
-  fseek(fptr, 0, SEEK_END);
-  new = ftell(fptr);
-  fseek(fptr, 0, old);
-  return new;
-}
-
 void cleanup(void){
   int i;
 
-  for(i = 0; i < (ascii_obj.height - 1); i++){
-    /* fprintf(stderr, "DEBUG: Freeing objline %d (%db)\n", i, strlen(ascii_obj.line[i]));*/
-    free(ascii_obj.line[i]);
-    /* fprintf(stderr, "DEBUG: Freeing blkline %d (%db)\n", i, strlen(ascii_obj.blank[i]));*/
-    free(ascii_obj.blank[i]);
+  render_free(render);
+  render = NULL;
+  wall_free(wall);
+  wall = NULL;
+  rotate_stop();
+
+  /* Don't leave the shell stopped behind --watch */
+  if(watch_pgrp != -1){
+    tcsetpgrp(STDIN_FILENO, watch_pgrp);
+    kill(-watch_pgrp, SIGCONT);
+    watch_pgrp = -1;
   }
+  compose_free(compose);
+  particles_free(particles);
+  metrics_close(metrics);
+
+  for(i = 0; i < ART_ORIENTS; i++)
+    free(ascii_obj.grid[i]);
+
+  free(ascii_obj.blank);
+  half_free(ascii_obj.half);
+  art_free(ascii_obj.art);
+  effect_free(effect);
+  color_free();
     
   globfree(&list);
 
-  if(ascii_obj.data != NULL)
-    free(ascii_obj.data);
-
   free(scroll_buffer);
     
-  if(fd_ascii != NULL)
-    fclose(fd_ascii);
-
   if(vfd != -1)
     close(vfd);
 
@@ -277,6 +390,8 @@ void severe_error(char *message, ...){
   va_list args;
   char buffer[1024];
 
+  render_free(render);
+  render = NULL;
   endwin();
 
   va_start(args, message);
@@ -290,14 +405,6 @@ void severe_error(char *message, ...){
   exit(EXIT_FAILURE);
 }
 
-double tickcount(void){
-  struct timeval tick;
-  double time;
-  gettimeofday(&tick, 0);
-  time = (double) tick.tv_sec + ((double) tick.tv_usec) / 1000000;
-  return time;
-}
-
 void showver(void){
   printf("Terminal Screensaver v%s (C) 2006 Kristian Gunstone.\n\n", VERSION);
 }
@@ -310,19 +417,45 @@ void showcopyright(void){
 
 void usage(char *me){
   showver();
-  printf("Usage: %s [-s] [-r] [-l] [-n] [-h] [-V] "
+  printf("Usage: %s [-s] [-r] [-l] [-n] [-f] [-h] [-V] "
 	 "[-d delay] [-a ascii]\n", me);
 	 /*"[-d delay] [-a ascii] [-t script] [-u secs]\n", me);*/
   printf("Default: %s -d 120 -o .5 -e .1 -i 1 -a %s/default\n\n", me, DEFAULT_ASCII_DIR);
   printf("  -n, --no-delay              Disable ASCII mirroring\n");
+  printf("  -f, --flip                  Flip ASCII upside down on vertical bounces\n");
+  printf("      --mirror-map=[file]     Add mirror/flip character pairs from [file]\n");
   printf("  -s, --scrollbar             Show load average in a scrollbar\n");
   printf("  -r, --random                Choose random ascii file\n");
+  printf("      --gallery               Pick the ascii from pictures of all of them\n");
   printf("  -l, --lock-terminal         Lock terminal\n");
+  printf("      --watch=[secs]          Wait for [secs] without input, start, repeat\n");
   printf("  -d, --delay=[delay]         Update every [delay] milliseconds\n");
   printf("  -a, --ascii=[ascii]         Use ascii [ascii]\n");
   printf("  -o, --object-speed=[speed]  Set ascii speed (0.001 - 1.00)\n");
   printf("  -e, --uname-speed=[speed]   Set uname speed (0.001 - 1.00)\n");
   printf("  -i, --info-speed=[speed]    Set info speed (0.001 - 1.00)\n");
+  printf("      --rotate=[secs]         Switch to a random ascii every [secs] seconds\n");
+  printf("      --effect=[name]         Show plasma, matrix, starfield or fire instead\n");
+  printf("      --bench                 Time the effect kernels and exit\n");
+  printf("      --bench-art             Time loading and drawing big ascii and exit\n");
+  printf("      --generate-art=[WxH,c,m] Print made up ascii, [c]%% colored, [m]%% mirrored\n");
+  printf("      --threads=[n]           Compose the screen in [n] threads\n");
+  printf("      --tiles=[n]             Split the screen in [n] bands for --threads\n");
+  printf("      --particles[=n]         Sparks on bounces and trails, at most [n]\n");
+  printf("      --stats                 Show frame statistics on exit\n");
+  printf("      --import=[file]         Use a PPM/PGM picture as the ascii\n");
+  printf("      --import-width=[cols]   Make the picture [cols] wide (half the screen)\n");
+  printf("      --time-startup          Show what startup took and exit after one frame\n");
+  printf("      --metrics=[file]        Keep live statistics in [file] (in /dev/shm)\n");
+  printf("      --metrics-read=[file]   Print the statistics in [file] and exit\n");
+  printf("      --no-scroll-motion      Redraw the moving ascii instead of scrolling it\n");
+  printf("      --share-art             Load each ascii once for all tss (in /dev/shm)\n");
+  printf("      --label=[text]          Bouncing strftime() text, with {host}, {uptime}, {load}\n");
+  printf("      --label-speed=[speed]   Set label speed (0 - 1.00, 0 holds them still)\n");
+  printf("      --half-blocks           Draw the ascii in half blocks, moving by half rows\n");
+  printf("      --bench-motion          Compare output of moving text and half blocks and exit\n");
+  printf("      --render-thread         Write to the terminal in a thread of its own\n");
+  printf("      --wall=[tty,...]        Carry on across these ttys, left to right\n");
   /*
   printf(" [UNDONE] -t Show output of [script] in scrolltext\n");
   printf(" [UNDONE] -u Run [script] every [seconds] seconds\n");
@@ -467,6 +600,8 @@ int lock_screen(int w, int h){
       sleep(1);
     }
     failed_logins++;
+    if(metrics != NULL)
+      metrics_publish(metrics, &stats, failed_logins, tickcount());
   }    
     
   clear();
@@ -501,71 +636,895 @@ static struct passwd *my_getpwuid(uid_t uid){
   return pwd;
 }
 
-void colormvprintw(int y, int x, char *buf){
+void set_color(int pair){
+  if(pair == current_color)
+    return;
+
+  attroff(COLOR_PAIR(current_color));
+  current_color = pair;
+  attron(COLOR_PAIR(current_color));
+}
+
+/* Switch to palette entry [color] of the ascii object */
+void set_cell_color(int color){
+  struct paletteEx *p;
+
+  if(color <= ART_LEGACY_COLORS){
+    set_color(color);
+  }else{
+    p = &ascii_obj.art->palette[color];
+    set_color(color_pair(p->fg, p->bg));
+  }
+}
+
+void put_cell(struct cellEx *cell){
+  char buf[8];
+
+  if(cell->ch < 0x80){
+    addch(cell->ch);
+  }else if(utf8_output){
+    utf8_encode(cell->ch, buf);
+    addstr(buf);
+  }else{
+    addch(cell->ch < 0x100 ? cell->ch : '?');
+    if(cell->width == 2)
+      addch('?');
+  }
+}
+
+void draw_object(int y, int x){
+  struct cellEx *cell;
+  int color;
+  int r, c;
+
+  cell = ascii_obj.grid[ascii_obj.orient];
+  color = -1;
+
+  for(r = 0; r < ascii_obj.height; r++){
+    move(y + r, x);
+    for(c = 0; c < ascii_obj.width; c++, cell++){
+      /* Right half of a wide character; don't trust the terminal's idea of
+       * its width */
+      if(cell->width == 0){
+        move(y + r, x + c + 1);
+        continue;
+      }
+      /* One lookup per span of equal color */
+      if(cell->color != color){
+        color = cell->color;
+        set_cell_color(color);
+      }
+      put_cell(cell);
+    }
+  }
+
+  set_cell_color(ascii_obj.art->tail_color);
+}
+
+/* The half block picture of the ascii, standing in [phase] */
+void draw_half(int y, int x, int phase){
+  struct paletteEx *p;
+  struct cellEx *cell;
+  int color;
+  int r, c;
+
+  cell = ascii_obj.half->cell[ascii_obj.orient][phase];
+  color = -1;
+
+  for(r = 0; r < ascii_obj.height; r++){
+    move(y + r, x);
+    for(c = 0; c < ascii_obj.width; c++, cell++){
+      if(cell->color != color){
+        color = cell->color;
+        p = &ascii_obj.half->palette[color];
+        set_color(color <= ART_LEGACY_COLORS ? color : color_pair(p->fg, p->bg));
+      }
+      put_cell(cell);
+    }
+  }
+
+  set_cell_color(ascii_obj.art->tail_color);
+}
+
+/* A terminfo string of the terminal, NULL if it has none */
+char *capability(char *name){
+  char *value;
+
+  value = tigetstr(name);
+  return value == (char *)-1 ? NULL : value;
+}
+
+/* Find the scroll region, cursor and insert/delete character strings for
+ * shift_object(). 0 if the terminal lacks any of them. */
+int motion_init(void){
+  char *s;
+
+  motion.csr	= capability("csr");
+  motion.cup	= capability("cup");
+  motion.ri	= capability("ri");
+  motion.ind	= capability("ind");
+  if(motion.csr == NULL || motion.cup == NULL || motion.ri == NULL ||
+     motion.ind == NULL)
+    return 0;
+
+  /* Kept expanded; tparm() has only the one buffer */
+  s = capability("ich");
+  s = s != NULL ? tparm(s, 1) : capability("ich1");
+  if(s == NULL || strlen(s) >= MOTION_SIZE)
+    return 0;
+  strcpy(motion.ich, s);
+
+  s = capability("dch");
+  s = s != NULL ? tparm(s, 1) : capability("dch1");
+  if(s == NULL || strlen(s) >= MOTION_SIZE)
+    return 0;
+  strcpy(motion.dch, s);
+
+  return 1;
+}
+
+/* Add [s] to the sequences for the terminal, without the padding a
+ * terminfo string may ask for; nothing tss runs on needs it */
+void motion_puts(char *s){
+  for(; *s != 0 && motion.length < MOTION_BUFFER; s++){
+    if(s[0] == '$' && s[1] == '<' && strchr(s, '>') != NULL){
+      s = strchr(s, '>');
+      continue;
+    }
+    motion.buffer[motion.length++] = *s;
+  }
+}
+
+/* What shift_object() did to the terminal, done to [w] as well */
+void shift_window(WINDOW *w, int dx, int dy, int top, int left){
+  int y;
+
+  if(dy != 0){
+    scrollok(w, TRUE);
+    wsetscrreg(w, top, top + ascii_obj.height);
+    wscrl(w, -dy);
+    wsetscrreg(w, 0, screen_height - 1);
+    scrollok(w, FALSE);
+  }
+
+  for(y = ascii_obj.drawn_y + dy; dx != 0 && y < ascii_obj.drawn_y + dy + ascii_obj.height; y++){
+    wmove(w, y, left);
+    if(dx > 0)
+      winsch(w, ' ');
+    else
+      wdelch(w);
+  }
+}
+
+/* Move the drawn ascii by [dx], [dy] (-1, 0 or 1 each) on the terminal
+ * itself: its rows are scrolled within a scroll region for vertical
+ * steps, and a character is inserted or deleted in front of it on each
+ * row for horizontal ones. The terminal moves what is already there, so
+ * only the edge which came into view is left to send. Curses is told, so
+ * that its idea of the screen stays right; whatever else was on those
+ * rows moved along, and curses puts it back with the rest of the frame.
+ *
+ * Curses has sent everything it had at this point. The sequences go out
+ * in one write of their own, and leave the cursor where curses left it. */
+void shift_object(int dx, int dy){
+  int top, left;
+  int cursor_y, cursor_x;
+  int y;
+
+  top = dy > 0 ? ascii_obj.drawn_y : ascii_obj.drawn_y - 1;
+  left = dx > 0 ? ascii_obj.drawn_x : ascii_obj.drawn_x - 1;
+  motion.length = 0;
+
+  if(dy != 0){
+    motion_puts(tparm(motion.csr, top, top + ascii_obj.height));
+    motion_puts(tparm(motion.cup, dy > 0 ? top : top + ascii_obj.height, 0));
+    motion_puts(dy > 0 ? motion.ri : motion.ind);
+    motion_puts(tparm(motion.csr, 0, screen_height - 1));
+  }
+
+  for(y = ascii_obj.drawn_y + dy; dx != 0 && y < ascii_obj.drawn_y + dy + ascii_obj.height; y++){
+    motion_puts(tparm(motion.cup, y, left));
+    motion_puts(dx > 0 ? motion.ich : motion.dch);
+  }
+
+  getyx(curscr, cursor_y, cursor_x);
+  motion_puts(tparm(motion.cup, cursor_y, cursor_x));
+
+  /* Too tall for the buffer: curses sends the difference as usual */
+  if(motion.length < MOTION_BUFFER){
+    fwrite(motion.buffer, 1, motion.length, stdout);
+    fflush(stdout);
+    shift_window(curscr, dx, dy, top, left);
+  }
+  shift_window(stdscr, dx, dy, top, left);
+  ascii_obj.drawn_x += dx;
+  ascii_obj.drawn_y += dy;
+}
+
+/* Scrolling the ascii moves everything in its rows with it. Labels there
+ * are blanked first, to be drawn again after; one on top of the ascii
+ * would be dragged along, so then it is redrawn instead (0). */
+int lift_labels(void){
+  struct liveEx *l;
   int i;
 
-  move(y, x);
+  for(i = 0; i < live_count; i++){
+    l = &live[i];
+    if(l->drawn_x != -1 &&
+       l->drawn_y >= ascii_obj.drawn_y &&
+       l->drawn_y < ascii_obj.drawn_y + ascii_obj.height &&
+       l->drawn_x <= ascii_obj.drawn_x + ascii_obj.width &&
+       l->drawn_x + l->drawn_width >= ascii_obj.drawn_x)
+      return 0;
+  }
 
-  for(i = 0; i < strlen(buf); i++){
-    if(buf[i] == 27){
+  for(i = 0; i < live_count; i++){
+    l = &live[i];
+    if(l->drawn_x == -1 || l->drawn_y < ascii_obj.drawn_y - 1 ||
+       l->drawn_y > ascii_obj.drawn_y + ascii_obj.height)
+      continue;
+    mvprintw(l->drawn_y, l->drawn_x, "%*s", l->drawn_width, "");
+    l->drawn_x = -1;
+  }
 
-      if(buf[i + 2] == 27)
-	while(buf[i + 2] == 27)
-	  i += 2;
-	
-      attroff(COLOR_PAIR(current_color));
-      current_color = buf[i + 1] - 48;
-      attron(COLOR_PAIR(current_color));
-      
-      i += 2;
+  return 1;
+}
+
+/* Only touch the cells which changed when [frame] was entered */
+void draw_delta(int y, int x, int frame){
+  struct deltaEx *d;
+  int i;
 
+  d = &ascii_obj.art->delta[ascii_obj.orient][ascii_obj.art->frame[frame].delta_first];
+
+  for(i = 0; i < ascii_obj.art->frame[frame].delta_count; i++){
+    if(d[i].cell.width == 0)
+      continue;
+    set_cell_color(d[i].cell.color);
+    move(y + d[i].offset / ascii_obj.width,
+         x + d[i].offset % ascii_obj.width);
+    put_cell(&d[i].cell);
+  }
+
+  set_cell_color(ascii_obj.art->tail_color);
+}
+
+/* Draw the cells of the effect whose level changed since last time */
+void draw_effect(void){
+  unsigned char *level;
+  unsigned char *shown;
+  int x, y;
+
+  level = effect->level;
+  shown = effect->shown;
+
+  for(y = 0; y < effect->height; y++)
+    for(x = 0; x < effect->width; x++, level++, shown++){
+      if(*level == *shown)
+        continue;
+      *shown = *level;
+      set_color(effect_color(effect, *level));
+      mvaddch(y, x, effect_glyph(effect, *level, x, y));
     }
-    printw("%c", buf[i]);
+}
 
+/* Draw what differs between [back] and [front], and make them the same */
+void draw_cells(struct cellEx *back, struct cellEx *front, int width, int height){
+  int x, y;
+  int at_x;
+
+  for(y = 0; y < height; y++){
+    at_x = -1;
+    for(x = 0; x < width; x++, back++, front++){
+      if(back->ch == front->ch && back->color == front->color &&
+         back->width == front->width)
+        continue;
+      *front = *back;
+      if(back->width == 0)
+        continue;
+      if(x != at_x)
+        move(y, x);
+      set_cell_color(back->color);
+      put_cell(back);
+      at_x = x + back->width;
+    }
   }
+}
 
+void draw_composed(void){
+  draw_cells(compose->back, compose->front, compose->width, compose->height);
 }
 
-void perform_mirror(void){
-  int i, a, b;
-	
-  for(i = 0; i < ascii_obj.height; i++){
-    strcpy(ascii_obj.mirror, ascii_obj.line[i]);
-    /* Pre-flip color codes and char */
-    for(a = 0; a < strlen(ascii_obj.mirror) - 1; a++)
-      if(ascii_obj.mirror[a] == 27){
-	ascii_obj.mirror[a] = ascii_obj.mirror[a + 1];
-	ascii_obj.mirror[a + 1] = 27;
-	a++;
+/* The output thread's half of --render-thread */
+void show_cells(void *context, struct cellEx *cells, struct cellEx *front,
+                int width, int height){
+  (void)context;	/* There is only stdscr */
+  draw_cells(cells, front, width, height);
+  refresh();
+}
+
+/* The screen was cleared; everything is drawn again. The output thread,
+ * if any, has to be paused. */
+void forget_screen(void){
+  ascii_obj.drawn_x = -1;
+  color_repaint();
+  if(effect != NULL)
+    effect_dirty(effect, 0, 0, screen_width, screen_height);
+  if(compose != NULL)
+    compose_invalidate(compose);
+  if(wall != NULL)
+    wall_forget(wall);
+  if(render != NULL)
+    render_invalidate(render);
+}
+
+/* --watch: hand the terminal back until it was left alone for [idle]
+ * seconds, then take it over again */
+void watch_terminal(long idle, short lock){
+  int output;
+
+  if(render != NULL)
+    render_pause(render);
+  endwin();
+  if(lock){
+    sigprocmask(SIG_SETMASK, &osig, NULL);
+    restore_terminal();
+  }
+  /* Started in the background: the shell gets its terminal back */
+  if(watch_pgrp != -1){
+    tcsetpgrp(STDIN_FILENO, watch_pgrp);
+    kill(-watch_pgrp, SIGCONT);
+    watch_pgrp = -1;
+  }
+
+  /* A shell waiting for input would have it taken away from under it
+   * and log out; it is stopped until the terminal is handed back. A job
+   * of its which needs no input is only stopped once it is quiet too. */
+  output = 0;
+  for(;;){
+    if(watch_idle(STDIN_FILENO, idle, output) == -1)
+      severe_error("Could not watch the terminal: %s\n", strerror(errno));
+    watch_pgrp = tcgetpgrp(STDIN_FILENO);
+    if(watch_pgrp == getpgrp() || watch_pgrp == -1 || watch_pgrp == watch_shell ||
+       output)
+      break;
+    output = 1;
+  }
+
+  if(watch_pgrp == getpgrp() || watch_pgrp == -1){
+    watch_pgrp = -1;
+  }else{
+    kill(-watch_pgrp, SIGSTOP);
+    tcsetpgrp(STDIN_FILENO, getpgrp());
+  }
+
+  clear();
+  refresh();
+  if(lock){
+    sigprocmask(SIG_SETMASK, &sig, NULL);
+    ioctl(vfd, VT_SETMODE, &vtm);
+    tcsetattr(STDIN_FILENO, TCSANOW, &term);
+  }
+
+  forget_screen();
+  if(render != NULL)
+    render_resume(render);
+}
+
+/* Wait up to [usec] for a key, reading it straight from the terminal so
+ * that curses (busy in the output thread) is left alone. 1 on a key, or
+ * when the terminal went away. */
+int wait_key(long usec){
+  struct timeval timeout;
+  fd_set keys;
+  char key;
+
+  FD_ZERO(&keys);
+  FD_SET(STDIN_FILENO, &keys);
+  timeout.tv_sec = usec / 1000000;
+  timeout.tv_usec = usec % 1000000;
+
+  if(select(STDIN_FILENO + 1, &keys, NULL, NULL, &timeout) <= 0)
+    return 0;
+
+  return read(STDIN_FILENO, &key, 1) >= 0;
+}
+
+/* A gallery picture with its top left corner at [y], [x] */
+void draw_thumb(struct thumbEx *t, int y, int x){
+  struct cellEx *cell;
+  int r, c;
+
+  for(r = 0; r < t->height; r++)
+    for(c = 0; c < t->width; c++){
+      cell = &t->cell[r * t->width + c];
+      if(cell->width == 0)
+        continue;
+      set_color(color_pair(t->color[r * t->width + c].fg, t->color[r * t->width + c].bg));
+      move(y + r, x + c);
+      put_cell(cell);
+    }
+}
+
+/* --gallery: pick an ascii file from pages of pictures. Returns its index
+ * in the directory list, or -1 to quit. Pictures are made as their page
+ * comes up, and the next and previous pages are made while waiting for
+ * a key. */
+int run_gallery(void){
+  struct galleryEx *g;
+  struct thumbEx *t;
+  const char *name;
+  int columns, rows, per_page;
+  int selected, first, shown_first;
+  int chosen;
+  int redraw;
+  int key;
+  int i, x, y;
+
+  g = gallery_new(list.gl_pathv, list.gl_pathc);
+  if(g == NULL)
+    severe_error("Out of memory.\n");
+
+  columns = (screen_width - 1) / (GALLERY_THUMB_WIDTH + GALLERY_GAP);
+  rows = (screen_height - 2) / (GALLERY_THUMB_HEIGHT + 2);
+  if(columns < 1)
+    columns = 1;
+  if(rows < 1)
+    rows = 1;
+  per_page = columns * rows;
+
+  keypad(stdscr, TRUE);
+  selected = 0;
+  shown_first = -1;
+  chosen = -2;
+  redraw = 1;
+  while(chosen == -2){
+    first = selected / per_page * per_page;
+
+    if(first != shown_first){
+      erase();
+      set_color(ART_DEFAULT_COLOR);
+      mvprintw(0, 0, "%d ascii files, page %d of %d. Arrows, PgUp/PgDn: move, "
+               "Enter: start, q: quit", g->count, first / per_page + 1,
+               (g->count + per_page - 1) / per_page);
+      for(i = 0; i < per_page && first + i < g->count; i++){
+        t = gallery_thumb(g, first + i);
+        if(t == NULL)
+          severe_error("Out of memory.\n");
+        x = 1 + i % columns * (GALLERY_THUMB_WIDTH + GALLERY_GAP);
+        y = 1 + i / columns * (GALLERY_THUMB_HEIGHT + 2);
+        if(t->width == 0){
+          set_color(ART_DEFAULT_COLOR);
+          mvprintw(y + GALLERY_THUMB_HEIGHT / 2, x, "(unreadable)");
+        }else{
+          draw_thumb(t, y + (GALLERY_THUMB_HEIGHT - t->height) / 2,
+                     x + (GALLERY_THUMB_WIDTH - t->width) / 2);
+        }
       }
-    for(a = 0, b = strlen(ascii_obj.mirror) - 1; 
-        a < strlen(ascii_obj.mirror), b >= 0; 
-        a++, b--)
-      ascii_obj.line[i][b] = ascii_obj.mirror[a];
+      shown_first = first;
+      nodelay(stdscr, TRUE);	/* Time to make the neighbouring pages */
+    }
+
+    if(redraw){
+      set_color(ART_DEFAULT_COLOR);
+      for(i = 0; i < per_page && first + i < g->count; i++){
+        name = strrchr(list.gl_pathv[first + i], '/');
+        name = name != NULL ? name + 1 : list.gl_pathv[first + i];
+        if(first + i == selected)
+          attron(A_REVERSE);
+        mvprintw(1 + i / columns * (GALLERY_THUMB_HEIGHT + 2) + GALLERY_THUMB_HEIGHT,
+                 1 + i % columns * (GALLERY_THUMB_WIDTH + GALLERY_GAP),
+                 "%-*.*s", GALLERY_THUMB_WIDTH, GALLERY_THUMB_WIDTH, name);
+        attroff(A_REVERSE);
+      }
+      t = gallery_thumb(g, selected);
+      move(screen_height - 1, 0);
+      clrtoeol();
+      if(t != NULL && t->width > 0)
+        mvprintw(screen_height - 1, 0, "%.*s: %dx%d, %d frame%s",
+                 screen_width - 32, list.gl_pathv[selected],
+                 t->art_width, t->art_height, t->frames, t->frames == 1 ? "" : "s");
+      refresh();
+      redraw = 0;
+    }
+
+    key = getch();
+    if(key == ERR){
+      if(!gallery_prefetch(g, first + per_page, per_page) &&
+         !gallery_prefetch(g, first - per_page, per_page))
+        nodelay(stdscr, FALSE);
+      continue;
+    }
+
+    switch(key){
+    case KEY_LEFT:  case 'h': selected--; break;
+    case KEY_RIGHT: case 'l': selected++; break;
+    case KEY_UP:    case 'k': selected -= columns; break;
+    case KEY_DOWN:  case 'j': selected += columns; break;
+    case KEY_PPAGE: case 'b': selected -= per_page; break;
+    case KEY_NPAGE: case ' ': selected += per_page; break;
+    case KEY_HOME:  case 'g': selected = 0; break;
+    case KEY_END:   case 'G': selected = g->count - 1; break;
+    case KEY_ENTER: case '\r': case '\n': chosen = selected; break;
+    case 'q':       case 27: chosen = -1; break;
+    }
+    if(selected < 0)
+      selected = 0;
+    if(selected >= g->count)
+      selected = g->count - 1;
+    redraw = 1;
   }
 
-  /* Correct parralel characters */
-  for(i = 0; i < ascii_obj.height; i++)
-    for(a = 0; a < strlen(ascii_obj.line[i]); a++)
-      for(b = 0; b < strlen(mirrorchr[0]); b++)
-	if(ascii_obj.line[i][a] == mirrorchr[0][b]){
-	  ascii_obj.line[i][a] = mirrorchr[1][b];
-	  break;
-	}
+  keypad(stdscr, FALSE);
+  nodelay(stdscr, TRUE);
+  erase();
+  gallery_free(g);
+
+  return chosen;
+}
+
+/* --bench-art: draw [grid] exactly like the main loop draws the object */
+void bench_draw(struct artEx *art, struct cellEx *grid){
+  struct ascii_objEx saved;
+
+  saved = ascii_obj;
+  ascii_obj.art		= art;
+  ascii_obj.grid[ART_NORMAL] = grid;
+  ascii_obj.orient	= ART_NORMAL;
+  ascii_obj.width	= art->width;
+  ascii_obj.height	= art->height;
+
+  draw_object(0, 0);
+
+  ascii_obj = saved;
+}
+
+/* No terminal needed: curses draws in to a big screen which goes to
+ * /dev/null, so only the cost of drawing is measured */
+void bench_art(void){
+  SCREEN *screen;
+  FILE *out;
+
+  transform_init();
+
+  out = fopen("/dev/null", "w");
+  screen = NULL;
+  if(out != NULL){
+    screen = newterm("xterm-256color", out, stdin);
+    if(screen == NULL)
+      screen = newterm(NULL, out, stdin);
+  }
+
+  if(screen == NULL){
+    corpus_bench(NULL);
+  }else{
+    resize_term(1000, 1000);
+    if(has_colors())
+      color_init();
+    corpus_bench(bench_draw);
+    endwin();
+    color_free();
+    delscreen(screen);
+  }
+
+  if(out != NULL)
+    fclose(out);
+}
+
+/* --generate-art=WIDTHxHEIGHT[,COLORS[,MIRRORS]] */
+int generate_art(char *spec){
+  char *text;
+  long length;
+  int width, height;
+  int colors, mirrors;
+
+  colors = 0;
+  mirrors = 0;
+  if(sscanf(spec, "%dx%d,%d,%d", &width, &height, &colors, &mirrors) < 2 ||
+     width < 1 || height < 1 || width > 10000 || height > 10000 ||
+     colors < 0 || colors > 100 || mirrors < 0 || mirrors > 100)
+    return -1;
+
+  text = corpus_art(width, height, colors, mirrors, 1, &length);
+  if(text == NULL)
+    return -1;
+
+  fwrite(text, 1, length, stdout);
+  free(text);
+  return 0;
+}
+
+/* Sparks where something [w] by [h] at [x], [y] hit an edge. [dx] or
+ * [dy] is the direction it is now moving away from that edge. */
+void sparks(float x, float y, int w, int h, float dx, float dy){
+  if(particles == NULL)
+    return;
+
+  particles_burst(particles,
+                  dx > 0 ? x : dx < 0 ? x + w : x + w / 2.0f,
+                  dy > 0 ? y : dy < 0 ? y + h : y + h / 2.0f,
+                  dx > 0 ? 1 : dx < 0 ? -1 : 0,
+                  dy > 0 ? 1 : dy < 0 ? -1 : 0, SPARKS);
+}
+
+/* Particles go behind the ascii object but in front of effects */
+void draw_particles(void){
+  int x, y;
+  int i;
+
+  particles->drawn_count = 0;
+
+  for(i = 0; i < particles->count; i++){
+    x = particles->x[i];
+    y = particles->y[i];
+    if(effect == NULL &&
+       x >= ascii_obj.drawn_x && x < ascii_obj.drawn_x + ascii_obj.width &&
+       y >= ascii_obj.drawn_y && y < ascii_obj.drawn_y + ascii_obj.height)
+      continue;
+
+    set_color(particles_color(particles, i));
+    mvaddch(y, x, particles_glyph(particles, i));
+    particles->drawn[particles->drawn_count++] = y * screen_width + x;
+  }
+
+  if(effect == NULL)
+    set_cell_color(ascii_obj.art->tail_color);
+}
+
+void blank_particles(void){
+  int x, y;
+  int i;
+
+  for(i = 0; i < particles->drawn_count; i++){
+    x = particles->drawn[i] % screen_width;
+    y = particles->drawn[i] / screen_width;
+    mvaddch(y, x, ' ');
+    if(effect != NULL)
+      effect_dirty(effect, x, y, 1, 1);
+  }
+  particles->drawn_count = 0;
+}
+
+/* Put label [l] on the screen. Only characters which aren't there
+ * already are drawn, so a clock which ticked costs a digit or two. */
+void draw_live(struct liveEx *l){
+  chtype ch;
+  int x, y;
+  int i;
+
+  x = l->x;
+  y = l->y;
+  for(i = 0; i < l->width; i++){
+    ch = (unsigned char)l->text[i] | COLOR_PAIR(current_color);
+    if((mvinch(y, x + i) & (A_CHARTEXT | A_COLOR)) != ch)
+      mvaddch(y, x + i, (unsigned char)l->text[i]);
+  }
+
+  l->drawn_x		= x;
+  l->drawn_y		= y;
+  l->drawn_width	= l->width;
+}
+
+/* Turn the object the way the ascii file asked for, if it did */
+void face_ascii(void){
+  ascii_obj.orient = ART_NORMAL;
+
+  if(ascii_obj.art->forced_direction != 0 && ascii_obj.grid[ART_MIRROR] != NULL)
+    if((ascii_obj.direction_x < 0 ? -1 : 1) != ascii_obj.art->forced_direction)
+      ascii_obj.orient = ART_MIRROR;
+}
+
+/* Replace the ascii object. Takes ownership of [art] and [grid]. */
+void set_ascii(struct artEx *art, struct cellEx **grid){
+  int i;
+
+  if(ascii_obj.drawn_x != -1)
+    for(i = 0; i < ascii_obj.height; i++)
+      mvprintw(ascii_obj.drawn_y + i, ascii_obj.drawn_x, "%s", ascii_obj.blank);
+
+  for(i = 0; i < ART_ORIENTS; i++){
+    free(ascii_obj.grid[i]);
+    ascii_obj.grid[i] = grid[i];
+  }
+  /* The other ttys of the wall read the palette */
+  if(wall != NULL)
+    wall_pause(wall);
+  art_free(ascii_obj.art);
+  ascii_obj.art		= art;
+
+  ascii_obj.width	= art->width;
+  ascii_obj.height	= art->height;
+
+  half_free(ascii_obj.half);
+  ascii_obj.half = NULL;
+  if(half_blocks){
+    ascii_obj.half = half_new(art, ascii_obj.grid);
+    if(ascii_obj.half == NULL)
+      severe_error("Out of memory.\n");
+    ascii_obj.height	= ascii_obj.half->height;
+  }
+
+  /* Allocate blanking area */
+  free(ascii_obj.blank);
+  ascii_obj.blank = calloc(ascii_obj.width + 1, 1);
+  memset(ascii_obj.blank, 32, ascii_obj.width);
+
+  ascii_obj.max_x	= (screen_width - ascii_obj.width);
+  ascii_obj.max_y	= (screen_height - ascii_obj.height);
+
+  if(ascii_obj.x >= ascii_obj.max_x)
+    ascii_obj.x = ascii_obj.max_x - 1;
+  if(ascii_obj.y >= ascii_obj.max_y)
+    ascii_obj.y = ascii_obj.max_y - 1;
+
+  face_ascii();
+  ascii_obj.frame	= 0;
+  ascii_obj.frame_begin	= tickcount();
+  ascii_obj.drawn_x	= -1;
+  ascii_obj.drawn_y	= -1;
+
+  /* Palette indices on screen may mean something else now */
+  if(compose != NULL)
+    compose_invalidate(compose);
+  if(wall != NULL){
+    wall_palette(wall, ascii_obj.art->palette);
+    wall_resume(wall);
+  }
+}
+
+
+/* Move the ascii about for BENCH_SECONDS at [fps], at BENCH_SPEED
+ * whatever the rate, the way the main loop would, and show what went
+ * to [out]; [bytes] and [cpu_ms] get how much a second */
+void bench_motion_run(const char *name, FILE *out, double fps,
+                      double *bytes, double *cpu_ms){
+  struct stat st;
+  clock_t cpu;
+  long before;
+  long frames;
+  long steps;
+  int phase;
+  int i;
 
+  ascii_obj.x		= 1;
+  ascii_obj.y		= 1;
+  ascii_obj.direction_x	= BENCH_SPEED / fps;
+  ascii_obj.direction_y	= BENCH_SPEED / fps;
+  ascii_obj.drawn_x	= -1;
+  clear();
+  refresh();
+
+  fflush(out);
+  fstat(fileno(out), &st);
+  before = st.st_size;
+  steps = 0;
+  cpu = clock();
+
+  for(frames = 0; frames < BENCH_SECONDS * fps; frames++){
+    ascii_obj.x += ascii_obj.direction_x;
+    ascii_obj.y += ascii_obj.direction_y;
+    if(ascii_obj.x < 1 || ascii_obj.x >= ascii_obj.max_x)
+      ascii_obj.direction_x = -ascii_obj.direction_x;
+    if(ascii_obj.y < 1 || ascii_obj.y >= ascii_obj.max_y)
+      ascii_obj.direction_y = -ascii_obj.direction_y;
+
+    phase = ascii_obj.half != NULL ? (int)(ascii_obj.y * 2) & 1 : 0;
+    if((int)ascii_obj.x != ascii_obj.drawn_x || (int)ascii_obj.y != ascii_obj.drawn_y ||
+       phase != ascii_obj.drawn_phase){
+      if((int)ascii_obj.y != ascii_obj.drawn_y || phase != ascii_obj.drawn_phase)
+        steps++;
+      if(ascii_obj.drawn_x != -1)
+        for(i = 0; i < ascii_obj.height; i++)
+          mvprintw(ascii_obj.drawn_y + i, ascii_obj.drawn_x, "%s", ascii_obj.blank);
+      ascii_obj.drawn_x = ascii_obj.x;
+      ascii_obj.drawn_y = ascii_obj.y;
+      ascii_obj.drawn_phase = phase;
+      if(ascii_obj.half != NULL)
+        draw_half(ascii_obj.drawn_y, ascii_obj.drawn_x, phase);
+      else
+        draw_object(ascii_obj.drawn_y, ascii_obj.drawn_x);
+    }
+    refresh();
+  }
+
+  cpu = clock() - cpu;
+  fflush(out);
+  fstat(fileno(out), &st);
+  *bytes = (double)(st.st_size - before) / BENCH_SECONDS;
+  *cpu_ms = (double)cpu / CLOCKS_PER_SEC * 1000 / BENCH_SECONDS;
+  printf("%-12s %5.0f %9.1f %9.1f %10.0f %9.2f\n", name, fps,
+         (double)steps / BENCH_SECONDS,
+         steps > 0 ? (double)BENCH_SPEED * BENCH_SECONDS / steps : 0,
+         *bytes, *cpu_ms);
 }
 
+/* Text against half blocks at half the frame rate, on a made up colored
+ * ascii and a screen that goes to a file */
+void bench_motion(void){
+  struct cellEx *grid[ART_ORIENTS];
+  struct artEx *art;
+  SCREEN *screen;
+  FILE *out;
+  double bytes[3][2];		/* [16, 8, 4 fps][text, half blocks] */
+  double cpu[3][2];
+  char *text;
+  long length;
+  int rate, r;
+  int i;
+
+  out = tmpfile();
+  screen = NULL;
+  if(out != NULL){
+    screen = newterm("xterm-256color", out, stdin);
+    if(screen == NULL)
+      screen = newterm(NULL, out, stdin);
+  }
+  if(screen == NULL){
+    fprintf(stderr, "--bench-motion needs a terminfo entry for xterm-256color.\n");
+    if(out != NULL)
+      fclose(out);
+    return;
+  }
+
+  resize_term(50, 160);
+  screen_width	= 160;
+  screen_height	= 50;
+  utf8_output	= 1;
+  if(has_colors())
+    color_init();
+
+  printf("Ascii moving at %d rows and columns a second, per second of it:\n\n", BENCH_SPEED);
+  printf("%-12s %5s %9s %9s %10s %9s\n", "drawing", "fps", "v.steps", "v.step", "bytes", "cpu ms");
+
+  memset(bytes, 0, sizeof(bytes));
+  memset(cpu, 0, sizeof(cpu));
+  for(rate = 16, r = 0; rate >= 4; rate /= 2, r++)
+    for(half_blocks = 0; half_blocks < 2; half_blocks++){
+      text = corpus_art(40, 12, 10, 0, 1, &length);
+      art = text != NULL ? art_parse(text, length, 0) : NULL;
+      free(text);
+      if(art == NULL)
+        break;
+      for(i = 0; i < ART_ORIENTS; i++)
+        grid[i] = NULL;
+      grid[ART_NORMAL] = art_grid_new(art, ART_NORMAL);
+      if(grid[ART_NORMAL] == NULL){
+        art_free(art);
+        break;
+      }
+
+      ascii_obj.drawn_x = -1;
+      set_ascii(art, grid);
+      bench_motion_run(half_blocks ? "half blocks" : "text", out, rate,
+                       &bytes[r][half_blocks], &cpu[r][half_blocks]);
+    }
+
+  /* Half blocks at half the rate take as many vertical steps or more,
+   * and none bigger: they are at least as smooth */
+  printf("\n");
+  for(rate = 16, r = 0; r < 2; rate /= 2, r++)
+    if(bytes[r][0] > 0 && cpu[r][0] > 0)
+      printf("Half blocks at %d fps against text at %d: %+.0f%% bytes, %+.0f%% cpu\n",
+             rate / 2, rate, (bytes[r + 1][1] / bytes[r][0] - 1) * 100,
+             (cpu[r + 1][1] / cpu[r][0] - 1) * 100);
+
+  half_blocks = 0;
+  endwin();
+  color_free();
+  delscreen(screen);
+  fclose(out);
+}
 
 int main(int argc, char **argv){
 
-  struct stat sc;
-  struct vt_mode vtm;
   struct passwd *pwd;
-  static sigset_t sig;
   static struct sigaction sig_action;
-  static struct termios term;
 
   struct utsname _uname;
+  struct prefetchEx next;
+  struct sceneEx scene;
+  struct artEx *art;
+  struct cellEx *grid[ART_ORIENTS];
   struct nameEx{
     char text[128];
     char blank[128];
@@ -585,26 +1544,44 @@ int main(int argc, char **argv){
 
   char glob_string[MAXPATH];
   char file_name[MAXPATH];
+  char error[ART_ERROR_SIZE];
+  char *map_file;
+  char *import_file;
+  char *metrics_file;
+  char *wall_ttys;
   /*char file_script[MAXPATH];*/
 
-  short special;
-  short forced_direction;
   short file_set;
   short mirror;
+  short flip;
   short random;
+  short gallery;
   short busy;
   short screen_too_small;
   short lock;
   short schedule_scroll_replace;
   short default_scrolltext;
+  short redraw;
+  short advanced;
+  short show_stats;
+  short time_startup;
+  short render_thread;
+  short pressed;
 
-  int obj_check[MAXLINES];
-  int ansi_check[MAXLINES];
-  int offset;
   int name_count;
+  float live_speed;
+  struct liveEx *l;
 
   int ret;
-  int i, a, c;
+  int dropped;
+  int dx, dy;
+  int shift;
+  int phase;
+  long watch_delay;
+  int i, c;
+
+  int file_index;
+  int orients;
 
   int scroll_count;
   int scroll_length;
@@ -613,20 +1590,39 @@ int main(int argc, char **argv){
   double scroll_delay;
   double scroll_begin;
   double scroll_end;
+  double rotate_delay;
+  double rotate_begin;
+  double effect_begin;
+  double frame_begin;
+  double frame_last;
+  int effect_kind;
+  int threads;
+  int tiles;
+  int particle_capacity;
+  int import_width;
+
+  stats_phase(&phases, "start", tickcount());
 
   scroll_buffer		= NULL;
-  ascii_obj.data	= NULL;
-  for(i = 0; i < MAXLINES; i++){
-    ascii_obj.line[i]	= NULL;
-    ascii_obj.blank[i]	= NULL;
-  }
+  ascii_obj.blank	= NULL;
+  ascii_obj.art		= NULL;
+  for(i = 0; i < ART_ORIENTS; i++)
+    ascii_obj.grid[i]	= NULL;
   /* Set defaults */
   name[UNAME].speed	= .5;
   name[INFO].speed	= .1;
+  live_speed		= .05;
   ascii_obj.speed	= 1.0;
-  forced_direction	= 0;
-  special		= 0;
   mirror		= 1;
+  flip			= 0;
+  map_file		= NULL;
+  import_file		= NULL;
+  metrics_file		= NULL;
+  wall_ttys		= NULL;
+  watch_delay		= 0;		/* Seconds, 0 is off */
+  watch_pgrp		= -1;
+  watch_shell		= -1;
+  import_width		= 0;		/* Half the screen */
   current_color		= 8;
   file_set		= 0;
   failed_logins		= 0;
@@ -635,21 +1631,33 @@ int main(int argc, char **argv){
   name_count		= 1;
   lock			= 0;
   random		= 0;
+  gallery		= 0;
   delay			= 120000;	/* Microseconds */
   scroll_delay		= 5;		/* Seconds */
+  rotate_delay		= 0;		/* Seconds, 0 is off */
+  file_index		= -1;
+  effect		= NULL;
+  effect_kind		= -1;
+  compose		= NULL;
+  threads		= 0;		/* Draw straight to curses */
+  tiles			= 0;		/* 4 per thread */
+  particles		= NULL;
+  particle_capacity	= 0;		/* No particles */
+  show_stats		= 0;
+  time_startup		= 0;
+  render_thread		= 0;
+  scroll_motion		= 1;
   default_scrolltext 	= 1;
   bzero(file_name, MAXPATH);
-  bzero(ascii_obj.mirror, MAXLINES);
 
-  /* Mirrorable characters */
-  sprintf(mirrorchr[0], "/\\()<>{}[]bd`'");
-  sprintf(mirrorchr[1], "\\/)(><}{][db'`");
-
-  while( (i = getopt_long(argc, argv, "nsrld:a:o:e:i:Vh", long_options, NULL) ) != -1 )
+  while( (i = getopt_long(argc, argv, "nfsrld:a:o:e:i:Vh", long_options, NULL) ) != -1 )
     switch (i) {
     case 'n': mirror		= 0; break;
+    case 'f': flip		= 1; break;
+    case OPT_MIRROR_MAP: map_file = optarg; break;
     case 's': name_count	= 2; break;
     case 'r': random		= 1; break;
+    case OPT_GALLERY: gallery = 1; break;
     case 'l': lock		= 1; break;
     case 'd': delay = 1000 * atoi(optarg); break;
     case 'a':
@@ -681,11 +1689,142 @@ int main(int argc, char **argv){
 	      }else
 		name[INFO].speed = atof(optarg);
 	      break;
+    case OPT_ROTATE:
+	      if(atof(optarg) <= 0){
+		usage(argv[0]);
+                return EXIT_FAILURE;
+	      }
+	      rotate_delay	= atof(optarg);
+	      random		= 1;
+	      break;
+    case OPT_EFFECT:
+	      effect_kind = effect_find(optarg);
+	      if(effect_kind == -1){
+		usage(argv[0]);
+                return EXIT_FAILURE;
+	      }
+	      break;
+    case OPT_BENCH: effect_bench(300, 100); return EXIT_SUCCESS;
+    case OPT_BENCH_ART: bench_art(); return EXIT_SUCCESS;
+    case OPT_GENERATE_ART:
+	      if(generate_art(optarg) == -1){
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	      }
+	      return EXIT_SUCCESS;
+    case OPT_THREADS:
+    case OPT_TILES:
+	      if(atoi(optarg) < 1){
+		usage(argv[0]);
+                return EXIT_FAILURE;
+	      }
+	      if(i == OPT_THREADS)
+		threads = atoi(optarg);
+	      else
+		tiles = atoi(optarg);
+	      break;
+    case OPT_PARTICLES:
+	      particle_capacity = optarg != NULL ? atoi(optarg) : PARTICLE_CAPACITY;
+	      if(particle_capacity < 1){
+		usage(argv[0]);
+                return EXIT_FAILURE;
+	      }
+	      break;
+    case OPT_STATS: show_stats = 1; break;
+    case OPT_IMPORT: import_file = optarg; break;
+    case OPT_METRICS: metrics_file = optarg; break;
+    case OPT_RENDER_THREAD: render_thread = 1; break;
+    case OPT_WALL: wall_ttys = optarg; break;
+    case OPT_NO_SCROLL_MOTION: scroll_motion = 0; break;
+    case OPT_SHARE_ART: share_enable(); break;
+    case OPT_HALF_BLOCKS: half_blocks = 1; break;
+    case OPT_BENCH_MOTION: bench_motion(); return EXIT_SUCCESS;
+    case OPT_LABEL:
+	      if(live_count == LIVE_MAX){
+		fprintf(stderr, "At most %d labels can be shown\n", LIVE_MAX);
+		return EXIT_FAILURE;
+	      }
+	      if(live_parse(&live[live_count], optarg, LIVE_SIZE - 1, error) == -1){
+		fprintf(stderr, "%s", error);
+		return EXIT_FAILURE;
+	      }
+	      live_count++;
+	      break;
+    case OPT_LABEL_SPEED:
+	      if(atof(optarg) < 0 || atof(optarg) > 1.00){
+		usage(argv[0]);
+                return EXIT_FAILURE;
+	      }else
+		live_speed = atof(optarg);
+	      break;
+    case OPT_WATCH:
+	      watch_delay = atol(optarg);
+	      if(watch_delay < 1){
+		usage(argv[0]);
+                return EXIT_FAILURE;
+	      }
+	      break;
+    case OPT_METRICS_READ:
+      setgid(getgid());
+      setuid(getuid());
+      if(metrics_read(optarg, stdout, error) == -1){
+        fprintf(stderr, "%s", error);
+        return EXIT_FAILURE;
+      }
+      return EXIT_SUCCESS;
+    case OPT_TIME_STARTUP: time_startup = 1; break;
+    case OPT_IMPORT_WIDTH:
+	      import_width = atoi(optarg);
+	      if(import_width < 1){
+		usage(argv[0]);
+                return EXIT_FAILURE;
+	      }
+	      break;
     case 'V': showver(); showcopyright(); return EXIT_SUCCESS;
     case 'h': usage(argv[0]); return EXIT_SUCCESS;
     default: usage(argv[0]); return EXIT_SUCCESS;
     }
 
+  if(rotate_delay > 0 && file_set){
+    fprintf(stderr, "--rotate picks files by itself and can't be used with -a.\n");
+    return EXIT_FAILURE;
+  }
+
+  if(effect_kind != -1 && (rotate_delay > 0 || file_set)){
+    fprintf(stderr, "--effect replaces the ascii and can't be used with -a or --rotate.\n");
+    return EXIT_FAILURE;
+  }
+
+  if(import_file != NULL && (rotate_delay > 0 || file_set || effect_kind != -1)){
+    fprintf(stderr, "--import can't be used with -a, --rotate or --effect.\n");
+    return EXIT_FAILURE;
+  }
+
+  if(gallery && (file_set || effect_kind != -1 || import_file != NULL)){
+    fprintf(stderr, "--gallery can't be used with -a, --effect or --import.\n");
+    return EXIT_FAILURE;
+  }
+
+  if(watch_delay > 0 && wall_ttys != NULL){
+    fprintf(stderr, "--watch can't be used with --wall.\n");
+    return EXIT_FAILURE;
+  }
+
+  if(half_blocks && (effect_kind != -1 || threads > 0 || tiles > 0 ||
+                     render_thread || wall_ttys != NULL)){
+    fprintf(stderr, "--half-blocks can't be used with --effect, --threads, --tiles, --render-thread or --wall.\n");
+    return EXIT_FAILURE;
+  }
+
+  if(watch_delay > 0 && !isatty(STDIN_FILENO)){
+    fprintf(stderr, "--watch needs a terminal to watch.\n");
+    return EXIT_FAILURE;
+  }
+  if(watch_delay > 0 && tcgetpgrp(STDIN_FILENO) != getpgrp())
+    watch_shell = tcgetpgrp(STDIN_FILENO);
+
+  stats_phase(&phases, "options", tickcount());
+
   /* Init */
   srand(time(NULL));
 
@@ -715,23 +1854,27 @@ int main(int argc, char **argv){
   bzero(name[INFO].text, 128);
   memset(name[INFO].text, 32, SCROLL_BOX_WIDTH);
 
+  stats_phase(&phases, "uname, load average", tickcount());
+
+  /* Started in the background, --watch still sets up the terminal and
+   * takes it over later */
+  if(watch_delay > 0)
+    signal(SIGTTOU, SIG_IGN);
+
   /* Init curses */
+  setlocale(LC_CTYPE, "");
+  utf8_output = strcmp(nl_langinfo(CODESET), "UTF-8") == 0;
+  if(half_blocks && !utf8_output){
+    fprintf(stderr, "--half-blocks needs a UTF-8 terminal.\n");
+    return EXIT_FAILURE;
+  }
   initscr();
 
   screen_width 		= COLS;
   screen_height 	= LINES;
 
-  if(has_colors()){
-    start_color(); /* VT100 Color init */
-    init_pair(1, COLOR_BLACK,	COLOR_BLACK);
-    init_pair(2, COLOR_RED,	COLOR_BLACK);
-    init_pair(3, COLOR_GREEN,	COLOR_BLACK);
-    init_pair(4, COLOR_YELLOW,	COLOR_BLACK);
-    init_pair(5, COLOR_BLUE,	COLOR_BLACK);
-    init_pair(6, COLOR_MAGENTA,	COLOR_BLACK);
-    init_pair(7, COLOR_CYAN,	COLOR_BLACK);
-    init_pair(8, COLOR_WHITE,	COLOR_BLACK);
-  }
+  if(has_colors())
+    color_init();
   
   curs_set(0);
   raw();
@@ -739,6 +1882,11 @@ int main(int argc, char **argv){
   noecho();
   attron(A_BOLD);
 
+  if(scroll_motion)
+    scroll_motion = motion_init();
+
+  stats_phase(&phases, "curses", tickcount());
+
   /* Init locking if enabled */
   if(lock){
 
@@ -817,8 +1965,27 @@ int main(int argc, char **argv){
   setuid(getuid());
   setgid(getgid());
 
+  /* Only now, so the file is made as the user */
+  if(metrics_file != NULL){
+    metrics = metrics_open(metrics_file, error);
+    if(metrics == NULL)
+      severe_error("%s", error);
+  }
+
+  /* The canvas goes on over the other terminals */
+  if(wall_ttys != NULL){
+    wall = wall_new(wall_ttys, screen_width, screen_height, utf8_output, error);
+    if(wall == NULL)
+      severe_error("%s", error);
+    screen_width	= wall->width;
+    screen_height	= wall->height;
+  }
+  stats.frame_budget = delay / 1000000.0;
+
+  stats_phase(&phases, "locking", tickcount());
+
   /* check files and directories */
-  if(!file_set){ /* Skip directory and file checks if user set ascii */
+  if(!file_set && effect_kind == -1 && import_file == NULL){ /* Skip directory and file checks if user set ascii */
     ret = glob(glob_string, GLOB_ERR|GLOB_MARK, NULL, &list);
     if(ret != 0){
       fprintf(stderr, "\nCouldn't read \"%s\".\n", DEFAULT_ASCII_DIR);
@@ -839,126 +2006,75 @@ int main(int argc, char **argv){
     if(list.gl_pathc == 0)
       severe_error("\"%s\" contains no files.\n", DEFAULT_ASCII_DIR);
 
-    if(random)
-      sprintf(file_name, "%s", list.gl_pathv[rand()%list.gl_pathc]);
-    else{
+    if(gallery){
+      file_index = run_gallery();
+      if(file_index == -1){
+        if(lock){
+          sigprocmask(SIG_SETMASK, &osig, NULL);
+          restore_terminal();
+        }
+        endwin();
+        cleanup();
+        return EXIT_SUCCESS;
+      }
+      sprintf(file_name, "%s", list.gl_pathv[file_index]);
+    }else if(random){
+      file_index = rand()%list.gl_pathc;
+      sprintf(file_name, "%s", list.gl_pathv[file_index]);
+    }else{
       glob_string[strlen(glob_string) - 1] = 0;
       sprintf(file_name, "%s%s", glob_string, DEFAULT_ASCII);
     }
   }
 
-  if(stat(file_name, &sc) == -1){
-    severe_error("Cannot stat \"%s\": %s\n", 
-                 file_name,
-                 strerror(errno));
+  stats_phase(&phases, "ascii directory", tickcount());
+
+  /* Character maps for mirroring and flipping */
+  transform_init();
+  if(map_file != NULL)
+    if(transform_load(map_file, error) == -1)
+      severe_error("%s", error);
+
+  /* Copies to prepare: mirrored always, for ESC l/r */
+  orients = 1 << ART_MIRROR;
+  if(flip)
+    orients |= 1 << ART_FLIP | 1 << (ART_MIRROR | ART_FLIP);
+
+  stats_phase(&phases, "mirror maps", tickcount());
+
+  ascii_obj.drawn_x	= -1;
+
+  if(effect_kind != -1){
+    effect = effect_new(effect_kind, screen_width, screen_height, effect_best_path());
+    if(effect == NULL)
+      severe_error("Out of memory.\n");
   }else{
-    if(! S_ISREG(sc.st_mode))
-      severe_error("\"%s\" is not a regular file.\n", file_name);
-  }
- 
-  fd_ascii = fopen(file_name, "rb");
-  if(!fd_ascii)
-    severe_error("\"%s\" could not be read: %s\n", 
-                 file_name,
-                 strerror(errno));
- 
-  if(lof(fd_ascii) == 0)
-    severe_error("\"%s\" is empty.\n", file_name);
-
-  if(lof(fd_ascii) > MAX_ASCII_SIZE)
-    severe_error("\"%s\" is too large(max %db allowed)\n",
-                 file_name,
-                 MAX_ASCII_SIZE);
-
-  /* Read files */
-  /* Read ascii object */
-  ascii_obj.data = calloc(lof(fd_ascii), 1);
-  fread(ascii_obj.data, 1, lof(fd_ascii), fd_ascii);
-
-  /* Check first two bytes for controls */
-  if(lof(fd_ascii) > 2){
-    if(ascii_obj.data[0] == 27){
-      switch(ascii_obj.data[1]){
-      case 'n': 
-	mirror = 0;
-	special = 1;
-	break;
-      case 'l': 
-	forced_direction = -1;
-	special = 1;
-	break;
-      case 'r': 
-	forced_direction = 1;
-	special = 1;
-	break;
-      }
-      if(special){
-	strncpy(ascii_obj.data, &ascii_obj.data[2], lof(fd_ascii) - 2);
-	ascii_obj.data[lof(fd_ascii) - 2] = '\0';
-      }
-    }
-  }
-  	 
-  fclose(fd_ascii);
-  fd_ascii = NULL;
-  
-  /* Load object in to buffers */
-  ascii_obj.width	= 0;
-  ascii_obj.height	= 0;
-  offset		= 0;
-
-  for(i = 0; i < strlen(ascii_obj.data); i++){
-    if(ascii_obj.data[i] == '\n'){
-      /*ascii_obj.line[ascii_obj.height] = calloc(offset + 1, 1);*/
-      ascii_obj.line[ascii_obj.height] = calloc(512, 1);
-      memcpy(ascii_obj.line[ascii_obj.height], 
-	     &ascii_obj.data[i - offset], 
-	     offset);
-      obj_check[ascii_obj.height++] = offset;
-      offset = 0;
+    /* Read and compile ascii object */
+    if(import_file != NULL){
+      if(import_width == 0)
+        import_width = screen_width / 2;
+      if(import_width > screen_width - 3)
+        import_width = screen_width - 3;
+      art = import_art(import_file, import_width, screen_height - 3, orients, error);
     }else{
-      offset++;
+      art = art_load(file_name, orients, error);
+    }
+    if(art == NULL)
+      severe_error("%s", error);
+
+    for(i = 0; i < ART_ORIENTS; i++){
+      grid[i] = NULL;
+      if(art->cell[i] != NULL){
+        grid[i] = art_grid_new(art, i);
+        if(grid[i] == NULL)
+          severe_error("Out of memory.\n");
+      }
     }
-  }
-
-  free(ascii_obj.data);
-  ascii_obj.data	= NULL;
 
-  /* Check widest line */
-  for(i = 0; i < ascii_obj.height; i++){
-    ansi_check[i] = obj_check[i];
-    for(a = 0; a < strlen(ascii_obj.line[i]); a++)
-      if(ascii_obj.line[i][a] == 27)
-	obj_check[i] -= 2;
+    set_ascii(art, grid);
   }
 
-  for(i = 0; i < ascii_obj.height; i++)
-    for(a = 0; a <= i; a++)
-      if(obj_check[a] > ascii_obj.width)
-	ascii_obj.width = obj_check[a];
-  
-  for(i = 0; i < ascii_obj.height; i++)
-    for(a = 0; a <= i; a++)
-      if(ansi_check[a] > ascii_obj.width_real)
-	ascii_obj.width_real = ansi_check[a];
-
-  if(ascii_obj.width == 0)
-    ascii_obj.width = strlen(ascii_obj.line[0]);
-
-  /* Autopad spacing and allocate blanking area*/
-  for(i = 0; i < ascii_obj.height; i++){
-    offset = ascii_obj.width - obj_check[i];
-    if(offset > 0){
-      ascii_obj.line[i] = realloc(ascii_obj.line[i], ansi_check[i] + offset + 1);
-      memset(&ascii_obj.line[i][ansi_check[i]], 32, offset);
-      ascii_obj.line[i][ansi_check[i] + offset] = '\0';
-    }
-    /* fprintf(stderr, "Padding line %2d %2d bytes. (%2db in total)\n", i, offset, ansi_check[i] + offset); */
-    ascii_obj.blank[i] = calloc(ascii_obj.width + 1, 1);
-    memset(ascii_obj.blank[i], 32, ascii_obj.width);
-    ascii_obj.blank[i][ascii_obj.width] = '\0';
-    
-  }
+  stats_phase(&phases, effect != NULL ? "effect" : "load ascii", tickcount());
 
   /* FIXME: Needs to be in same place as nonexistent resizing handler */
   /* Check if terminal is big enough */
@@ -1001,26 +2117,77 @@ int main(int argc, char **argv){
   name[INFO].direction_x	= rand()%2?-name[INFO].speed:name[INFO].speed;
   name[INFO].direction_y	= rand()%2?-name[INFO].speed:name[INFO].speed;
 
-  ascii_obj.max_x	= (screen_width - ascii_obj.width);
-  ascii_obj.max_y	= (screen_height - ascii_obj.height);
+  for(i = 0; i < live_count; i++){
+    l = &live[i];
+    l->limit		= screen_width - 3 < LIVE_SIZE - 1 ? screen_width - 3 : LIVE_SIZE - 1;
+    l->next		= 0;
+    live_update(l, tickcount());
+    l->max_x		= screen_width - l->width;
+    l->max_y		= screen_height - 1;
+    l->x		= 1 + rand()%(l->max_x - 1);
+    l->y		= 1 + rand()%(l->max_y - 1);
+    l->direction_x	= rand()%2?-live_speed:live_speed;
+    l->direction_y	= rand()%2?-live_speed:live_speed;
+  }
+
+  if(effect == NULL){
+    ascii_obj.x		=  1 + rand()%(ascii_obj.max_x - 1);
+    ascii_obj.y		=  1 + rand()%(ascii_obj.max_y - 1);
+    ascii_obj.direction_x	= rand()%2?-ascii_obj.speed:ascii_obj.speed;
+    ascii_obj.direction_y	= rand()%2?-ascii_obj.speed:ascii_obj.speed;
+
+    face_ascii();
+    ascii_obj.drawn_orient= ascii_obj.orient;
+  }
+
+  /* The output thread is fed composed frames */
+  if((tiles > 0 || render_thread || wall != NULL) && threads == 0)
+    threads = 1;
+  if(threads > 0){
+    compose = compose_new(screen_width, screen_height,
+                          tiles > 0 ? tiles : 4 * threads, threads);
+    if(compose == NULL)
+      severe_error("Could not start the compositor.\n");
+  }
 
-  ascii_obj.x		=  1 + rand()%(ascii_obj.max_x - 1);
-  ascii_obj.y		=  1 + rand()%(ascii_obj.max_y - 1);
-  ascii_obj.direction_x	= rand()%2?-ascii_obj.speed:ascii_obj.speed;
-  ascii_obj.direction_y	= rand()%2?-ascii_obj.speed:ascii_obj.speed;
+  if(render_thread){
+    render = render_new(wall != NULL ? wall->home_width : screen_width,
+                        screen_height, show_cells, NULL);
+    if(render == NULL)
+      severe_error("Could not start the output thread.\n");
+  }
+
+  if(particle_capacity > 0){
+    particles = particles_new(particle_capacity);
+    if(particles == NULL)
+      severe_error("Out of memory.\n");
+  }
 
-  if(forced_direction != 0)
-    if(ascii_obj.direction_x != forced_direction)
-      perform_mirror();
+  /* Start loading the next object in the background */
+  if(rotate_delay > 0)
+    if(rotate_init(&list, file_index, orients, screen_width, screen_height) == -1)
+      severe_error("Could not start the ascii loader.\n");
+
+  stats_phase(&phases, "threads, positions", tickcount());
+
+  /* Everything is loaded; wait for the terminal to be left alone */
+  if(watch_delay > 0)
+    watch_terminal(watch_delay, lock);
 
   /* Init scroller */
   scroll_length = strlen(scroll_buffer);
   scroll_count = 0;
   scroll_begin = tickcount();
+  rotate_begin = tickcount();
+  ascii_obj.frame_begin = tickcount();
+  effect_begin = tickcount();
+  frame_last = tickcount();
 
   /* Main run */
+  schedule_scroll_replace = 0;
   busy = 1;
   while(busy){
+    frame_begin = tickcount();
 
     /* Scroll check */
     scroll_end = tickcount() - scroll_begin;
@@ -1030,47 +2197,263 @@ int main(int argc, char **argv){
     }
 
     /* Blank */
-    for(i = 0; i < name_count; i++)
+    redraw = 0;
+    for(i = 0; i < name_count; i++){
+      if(compose != NULL)
+        continue;
+
       mvprintw(name[i].y, name[i].x, "%s", name[i].blank);
 
-    for(i = 0; i < ascii_obj.height; i++)
-      mvprintw((ascii_obj.y + i), ascii_obj.x, "%s", ascii_obj.blank[i]);
-    
+      if(effect != NULL)
+        effect_dirty(effect, name[i].x, name[i].y, name[i].width, name[i].height);
+
+      /* A blanked name may have cut a hole in the object */
+      if((int)name[i].y >= ascii_obj.drawn_y && 
+         (int)name[i].y < ascii_obj.drawn_y + ascii_obj.height &&
+         (int)name[i].x < ascii_obj.drawn_x + ascii_obj.width &&
+         (int)name[i].x + name[i].width > ascii_obj.drawn_x)
+        redraw = 1;
+    }
+
+    /* Labels keep to their own schedule, and are only blanked when they
+     * moved or got shorter */
+    for(i = 0; i < live_count; i++){
+      l = &live[i];
+      live_update(l, frame_begin);
+      l->max_x = screen_width - l->width;
+      if(l->x > l->max_x)
+        l->x = l->max_x;
+
+      l->x += l->direction_x;
+      l->y += l->direction_y;
+
+      if(l->x < 1 || l->x >= l->max_x){
+	l->direction_x = -l->direction_x;
+	sparks(l->x, l->y, l->width, 1, l->direction_x, 0);
+      }
+
+      if(l->y < 1 || l->y >= l->max_y){
+	l->direction_y = -l->direction_y;
+	sparks(l->x, l->y, l->width, 1, 0, l->direction_y);
+      }
+
+      if(compose != NULL || l->drawn_x == -1 ||
+         ((int)l->x == l->drawn_x && (int)l->y == l->drawn_y &&
+          l->width >= l->drawn_width))
+        continue;
+
+      mvprintw(l->drawn_y, l->drawn_x, "%*s", l->drawn_width, "");
+
+      if(effect != NULL)
+        effect_dirty(effect, l->drawn_x, l->drawn_y, l->drawn_width, 1);
+
+      if(l->drawn_y >= ascii_obj.drawn_y &&
+         l->drawn_y < ascii_obj.drawn_y + ascii_obj.height &&
+         l->drawn_x < ascii_obj.drawn_x + ascii_obj.width &&
+         l->drawn_x + l->drawn_width > ascii_obj.drawn_x)
+        redraw = 1;
+      l->drawn_x = -1;
+    }
+
+    if(particles != NULL && compose == NULL)
+      blank_particles();
+
     /* Update vars */
     for(i = 0; i < name_count; i++){
       name[i].x += name[i].direction_x;
       name[i].y += name[i].direction_y;
    
-      if(name[i].x < 1 || name[i].x >= name[i].max_x)
+      if(name[i].x < 1 || name[i].x >= name[i].max_x){
 	name[i].direction_x = -name[i].direction_x;
+	sparks(name[i].x, name[i].y, name[i].width, 1, name[i].direction_x, 0);
+      }
  
-      if(name[i].y < 1 || name[i].y >= name[i].max_y)
+      if(name[i].y < 1 || name[i].y >= name[i].max_y){
 	name[i].direction_y = -name[i].direction_y;
+	sparks(name[i].x, name[i].y, name[i].width, 1, 0, name[i].direction_y);
+      }
     }
 
-    ascii_obj.x += ascii_obj.direction_x;
-    ascii_obj.y += ascii_obj.direction_y;
+    if(effect != NULL && compose != NULL){
+      effect_prepare(effect, tickcount() - effect_begin);
+    }else if(effect != NULL){
+      effect_step(effect, tickcount() - effect_begin);
+      draw_effect();
+    }else{
+      ascii_obj.x += ascii_obj.direction_x;
+      ascii_obj.y += ascii_obj.direction_y;
     
-    if(ascii_obj.x < 1 || ascii_obj.x >= ascii_obj.max_x){
-      ascii_obj.direction_x = -ascii_obj.direction_x;
+      if(ascii_obj.x < 1 || ascii_obj.x >= ascii_obj.max_x){
+        ascii_obj.direction_x = -ascii_obj.direction_x;
+        sparks(ascii_obj.x, ascii_obj.y, ascii_obj.width, ascii_obj.height,
+               ascii_obj.direction_x, 0);
 	
-      /* Mirror ascii */
-      if(mirror)
-	perform_mirror();
+        /* Mirror ascii */
+        if(mirror && ascii_obj.art->mirror)
+          ascii_obj.orient ^= ART_MIRROR;
       
-    }
+      }
     
-    if(ascii_obj.y < 1 || ascii_obj.y >= ascii_obj.max_y)
-      ascii_obj.direction_y = -ascii_obj.direction_y;
+      if(ascii_obj.y < 1 || ascii_obj.y >= ascii_obj.max_y){
+        ascii_obj.direction_y = -ascii_obj.direction_y;
+        sparks(ascii_obj.x, ascii_obj.y, ascii_obj.width, ascii_obj.height,
+               0, ascii_obj.direction_y);
+
+        /* Flip ascii */
+        if(flip && ascii_obj.art->orients & 1 << ART_FLIP)
+          ascii_obj.orient ^= ART_FLIP;
+      }
 
-    /* Draw */
-    for(i = 0; i < ascii_obj.height; i++)
-      colormvprintw((ascii_obj.y + i), ascii_obj.x, ascii_obj.line[i]);
+      /* Trail */
+      if(particles != NULL)
+        particles_emit(particles, PARTICLE_TRAIL,
+                       ascii_obj.direction_x > 0 ? ascii_obj.x - 1 : ascii_obj.x + ascii_obj.width,
+                       ascii_obj.y + rand() % ascii_obj.height,
+                       -ascii_obj.direction_x * 2, 0, 0.8f);
+
+      /* Rotate ascii, if the next one is ready yet */
+      if(rotate_delay > 0 && tickcount() - rotate_begin >= rotate_delay)
+        if(rotate_take(&next)){
+          if(render != NULL)
+            render_pause(render);
+          set_ascii(next.art, next.grid);
+          /* Out of pairs: start over, so the new colors get their own */
+          if(color_starved()){
+            clear();
+            forget_screen();
+          }
+          if(render != NULL){
+            render_invalidate(render);
+            render_resume(render);
+          }
+          rotate_begin = tickcount();
+        }
+
+      /* Animate */
+      advanced = 0;
+      if(ascii_obj.art->frame_count > 1 &&
+         (tickcount() - ascii_obj.frame_begin) * 1000 >= 
+         ascii_obj.art->frame[ascii_obj.frame].duration){
+        ascii_obj.frame = (ascii_obj.frame + 1) % ascii_obj.art->frame_count;
+        art_advance(ascii_obj.art, ascii_obj.frame, ascii_obj.grid);
+        ascii_obj.frame_begin = tickcount();
+        advanced = 1;
+      }
+
+      /* Half blocks stand on a row or half a row lower, and change all
+       * over with a new frame */
+      phase = 0;
+      if(ascii_obj.half != NULL){
+        phase = (int)(ascii_obj.y * 2) & 1;
+        if(advanced){
+          if(half_build(ascii_obj.half, ascii_obj.art, ascii_obj.grid) == -1)
+            severe_error("Out of memory.\n");
+          advanced = 0;
+          redraw = 1;
+        }
+      }
+
+      /* Draw. A step of one cell is scrolled, unless something cut a hole
+       * in the ascii. */
+      dx = (int)ascii_obj.x - ascii_obj.drawn_x;
+      dy = (int)ascii_obj.y - ascii_obj.drawn_y;
+      shift = scroll_motion && !redraw && ascii_obj.drawn_x != -1 &&
+              ascii_obj.half == NULL &&
+              ascii_obj.orient == ascii_obj.drawn_orient &&
+              dx >= -1 && dx <= 1 && dy >= -1 && dy <= 1;
+      if(shift && (dx != 0 || dy != 0))
+        shift = lift_labels();
+      if(dx != 0 || dy != 0 || ascii_obj.orient != ascii_obj.drawn_orient ||
+         phase != ascii_obj.drawn_phase)
+        redraw = 1;
+
+      if(compose != NULL){
+        /* Composed below, together with everything else */
+      }else if(redraw && shift){
+        shift_object(dx, dy);
+        if(advanced)
+          draw_delta(ascii_obj.drawn_y, ascii_obj.drawn_x, ascii_obj.frame);
+      }else if(redraw){
+        if(ascii_obj.drawn_x != -1)
+          for(i = 0; i < ascii_obj.height; i++)
+            mvprintw(ascii_obj.drawn_y + i, ascii_obj.drawn_x, "%s", ascii_obj.blank);
+
+        ascii_obj.drawn_x = ascii_obj.x;
+        ascii_obj.drawn_y = ascii_obj.y;
+        ascii_obj.drawn_orient = ascii_obj.orient;
+        ascii_obj.drawn_phase = phase;
+        if(ascii_obj.half != NULL)
+          draw_half(ascii_obj.drawn_y, ascii_obj.drawn_x, phase);
+        else
+          draw_object(ascii_obj.drawn_y, ascii_obj.drawn_x);
+      }else if(advanced){
+        draw_delta(ascii_obj.drawn_y, ascii_obj.drawn_x, ascii_obj.frame);
+      }
     
-    for(i = 0; i < name_count; i++)
-      mvprintw(name[i].y, name[i].x, "%s", name[i].text);
+    }
 
-    refresh();
+    if(particles != NULL){
+      particles_update(particles, frame_begin - frame_last, screen_width, screen_height);
+      stats_particles(&stats, particles);
+      if(compose == NULL)
+        draw_particles();
+    }
+    frame_last = frame_begin;
+
+    if(compose != NULL){
+      scene.effect		= effect;
+      scene.particles		= particles;
+      scene.sprite.cell		= effect == NULL ? ascii_obj.grid[ascii_obj.orient] : NULL;
+      scene.sprite.x		= ascii_obj.x;
+      scene.sprite.y		= ascii_obj.y;
+      scene.sprite.width	= ascii_obj.width;
+      scene.sprite.height	= ascii_obj.height;
+      scene.label_count		= name_count + live_count;
+      scene.label_color		= effect == NULL ? ascii_obj.art->tail_color : ART_DEFAULT_COLOR;
+      for(i = 0; i < name_count; i++){
+        scene.label[i].text	= name[i].text;
+        scene.label[i].x	= name[i].x;
+        scene.label[i].y	= name[i].y;
+      }
+      for(i = 0; i < live_count; i++){
+        scene.label[name_count + i].text	= live[i].text;
+        scene.label[name_count + i].x		= live[i].x;
+        scene.label[name_count + i].y		= live[i].y;
+      }
+
+      compose_frame(compose, &scene);
+      dropped = 0;
+      if(wall != NULL){
+        dropped = wall_publish(wall, compose->back);
+        if(render != NULL)
+          dropped += render_publish(render, wall->home);
+        else
+          draw_cells(wall->home, wall->home_front, wall->home_width, screen_height);
+      }else if(render == NULL)
+        draw_composed();
+      else
+        dropped = render_publish(render, compose->back);
+      stats.frames_dropped += dropped;
+    }else{
+      for(i = 0; i < name_count; i++)
+        mvprintw(name[i].y, name[i].x, "%s", name[i].text);
+      for(i = 0; i < live_count; i++)
+        draw_live(&live[i]);
+    }
+
+    if(render == NULL)
+      refresh();
+
+    if(stats.frames == 0){
+      stats_phase(&phases, "first frame", tickcount());
+      if(time_startup){
+        busy = 0;
+        continue;
+      }
+    }
+    stats_frame(&stats, tickcount() - frame_begin);
+    if(metrics != NULL)
+      metrics_publish(metrics, &stats, failed_logins, tickcount());
 
     /* Rotate scrolltext */
     if(name_count == 2){
@@ -1099,17 +2482,45 @@ int main(int argc, char **argv){
       }
     }
 
-    usleep(delay);
-    
-    if(getch() != EOF){
-      if(lock == 1)
-	busy = lock_screen(screen_width, screen_height);
-      else
+    /* With an output thread, a key is seen at once however slow the
+     * terminal is */
+    if(render != NULL){
+      pressed = wait_key(delay);
+    }else{
+      usleep(delay);
+      pressed = getch() != EOF;
+    }
+
+    if(pressed){
+      if(lock == 1){
+	if(render != NULL)
+	  render_pause(render);
+	busy = lock_screen(wall != NULL ? wall->home_width : screen_width,
+	                   screen_height);
+
+	/* lock_screen() cleared the screen; draw everything again */
+	forget_screen();
+	if(render != NULL)
+	  render_resume(render);
+      }else
 	busy = 0;
     }
 
+    /* Unlocked, or a key was pressed: wait for the next time */
+    if(!busy && watch_delay > 0){
+      watch_terminal(watch_delay, lock);
+      frame_last = tickcount();
+      busy = 1;
+    }
+
   }
 
+  /* The output threads may still be writing */
+  render_free(render);
+  render = NULL;
+  wall_free(wall);
+  wall = NULL;
+
   /* Restore signals and terminal if locked */
   if(lock){
     sigprocmask(SIG_SETMASK, &osig, NULL); /* Restore old signals */
@@ -1122,5 +2533,11 @@ int main(int argc, char **argv){
   if(failed_logins > 0)
     printf("%d failed login attempts.\n", failed_logins);
 
+  if(show_stats)
+    stats_print(&stats, stdout);
+
+  if(time_startup)
+    stats_print_phases(&phases, stdout);
+
   return 0;
 }
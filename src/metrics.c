@@ -0,0 +1,333 @@
+/* Terminal ScreenSaver - live metrics page
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * Publishing costs a few dozen stores per frame and no system calls. The
+ * numbers that do need one (resident size, bytes written, which VT is
+ * showing) and the percentiles are only refreshed every METRICS_SLOW
+ * seconds.
+ *
+ * */
+
+#define _XOPEN_SOURCE	500
+
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+
+#ifndef BSD
+ #include <sys/vt.h>
+#else
+ #include <sys/consio.h>
+#endif
+
+#include "metrics.h"
+
+#define SPINS			100000	/* Reader gives up after this */
+
+/* Our VT number, from the name of the terminal; 0 if it is no VT */
+static int vt_number(void){
+  const char *name;
+  unsigned int n;
+
+  name = ttyname(STDIN_FILENO);
+  if(name == NULL)
+    return 0;
+
+#ifndef BSD
+  if(sscanf(name, "/dev/tty%u", &n) == 1 && n > 0)
+    return n;
+#else
+  if(sscanf(name, "/dev/ttyv%x", &n) == 1)
+    return n + 1;
+#endif
+
+  return 0;
+}
+
+static int vt_active(struct metricsEx *m){
+#ifndef BSD
+  struct vt_stat state;
+
+  if(m->vt == 0 || ioctl(STDIN_FILENO, VT_GETSTATE, &state) == -1)
+    return -1;
+  return state.v_active == m->vt;
+#else
+  int active;
+
+  if(m->vt == 0 || ioctl(STDIN_FILENO, VT_GETACTIVE, &active) == -1)
+    return -1;
+  return active == m->vt;
+#endif
+}
+
+/* The number after [key] in a /proc file; -1 when there is none. When
+ * [key] is NULL, field [field] (counting from 0) of the first line. */
+static long proc_number(const char *file_name, const char *key, int field){
+  char line[256];
+  FILE *fd;
+  long value;
+  char *p;
+
+  fd = fopen(file_name, "r");
+  if(fd == NULL)
+    return -1;
+
+  value = -1;
+  while(value == -1 && fgets(line, sizeof(line), fd) != NULL){
+    if(key == NULL){
+      p = line;
+      while(field-- > 0 && p != NULL){
+        p = strchr(p, ' ');
+        if(p != NULL)
+          p++;
+      }
+      if(p != NULL)
+        value = atol(p);
+      break;
+    }
+    if(strncmp(line, key, strlen(key)) == 0)
+      value = atol(line + strlen(key));
+  }
+
+  fclose(fd);
+  return value;
+}
+
+static long resident(void){
+  struct rusage usage;
+  long pages;
+
+  pages = proc_number("/proc/self/statm", NULL, 1);
+  if(pages >= 0)
+    return pages * sysconf(_SC_PAGESIZE);
+
+  /* Peak rather than current, but better than nothing */
+  if(getrusage(RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss * 1024L;
+  return -1;
+}
+
+static void refresh_slow(struct metricsEx *m, struct statsEx *s){
+  m->vt_active		= vt_active(m);
+  /* Everything tss writes goes to the terminal; this page is mapped */
+  m->bytes_written	= proc_number("/proc/self/io", "wchar:", 0);
+  m->resident		= resident();
+  m->frame_p50		= stats_percentile(s, 50);
+  m->frame_p90		= stats_percentile(s, 90);
+  m->frame_p99		= stats_percentile(s, 99);
+}
+
+struct metricsEx *metrics_open(const char *file_name, char *error){
+  struct metricsEx *m;
+  unsigned long magic;
+  struct stat st;
+  void *page;
+  int fd;
+
+  fd = open(file_name, O_RDWR | O_CREAT, 0644);
+  if(fd == -1){
+    sprintf(error, "\"%.512s\" could not be opened: %s\n", file_name, strerror(errno));
+    return NULL;
+  }
+
+  /* Only ever overwrite our own kind of file */
+  if(fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+     (st.st_size != 0 && (st.st_size != sizeof(struct metricsPageEx) ||
+                          read(fd, &magic, sizeof(magic)) != sizeof(magic) ||
+                          magic != METRICS_MAGIC))){
+    sprintf(error, "\"%.512s\" exists and is not a tss metrics file.\n", file_name);
+    close(fd);
+    return NULL;
+  }
+
+  if(ftruncate(fd, sizeof(struct metricsPageEx)) == -1){
+    sprintf(error, "\"%.512s\" could not be sized: %s\n", file_name, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+
+  page = mmap(NULL, sizeof(struct metricsPageEx), PROT_READ | PROT_WRITE,
+              MAP_SHARED, fd, 0);
+  if(page == MAP_FAILED){
+    sprintf(error, "\"%.512s\" could not be mapped: %s\n", file_name, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+
+  m = calloc(1, sizeof(struct metricsEx));
+  if(m == NULL){
+    sprintf(error, "Out of memory.\n");
+    munmap(page, sizeof(struct metricsPageEx));
+    close(fd);
+    return NULL;
+  }
+
+  m->fd		= fd;
+  m->page	= page;
+  m->vt		= vt_number();
+  m->slow_at	= -METRICS_SLOW;
+
+  /* A reader that maps the page half way through this sees an odd count
+   * or a wrong magic and tries again. The count is odd already if the
+   * last tss to use the file died while writing. */
+  m->page->sequence |= 1;
+  __sync_synchronize();
+  memset((char *)m->page + sizeof(m->page->magic) + sizeof(m->page->sequence), 0,
+         sizeof(struct metricsPageEx) - sizeof(m->page->magic) - sizeof(m->page->sequence));
+  m->page->pid		= getpid();
+  m->page->running	= 1;
+  m->page->vt_active	= -1;
+  m->page->bytes_written = -1;
+  m->page->magic	= METRICS_MAGIC;
+  __sync_synchronize();
+  m->page->sequence++;
+
+  return m;
+}
+
+void metrics_close(struct metricsEx *m){
+  if(m == NULL)
+    return;
+
+  /* The last numbers stay in the file */
+  m->page->sequence++;
+  __sync_synchronize();
+  m->page->running = 0;
+  __sync_synchronize();
+  m->page->sequence++;
+
+  munmap(m->page, sizeof(struct metricsPageEx));
+  close(m->fd);
+  free(m);
+}
+
+void metrics_publish(struct metricsEx *m, struct statsEx *s,
+                     long failed_unlocks, double now){
+  struct metricsPageEx *p = m->page;
+
+  if(now - m->slow_at >= METRICS_SLOW || now < m->slow_at){
+    refresh_slow(m, s);
+    m->slow_at = now;
+  }
+
+  p->sequence++;
+  __sync_synchronize();
+
+  p->updated		= now;
+  p->frames		= s->frames;
+  p->frames_skipped	= s->frames_skipped;
+  p->frames_dropped	= s->frames_dropped;
+  p->failed_unlocks	= failed_unlocks;
+  p->frame_average	= s->frames > 0 ? s->frame_time / s->frames : 0;
+  p->frame_max		= s->frame_time_max;
+  p->frame_p50		= m->frame_p50;
+  p->frame_p90		= m->frame_p90;
+  p->frame_p99		= m->frame_p99;
+  p->vt_active		= m->vt_active;
+  p->bytes_written	= m->bytes_written;
+  p->resident		= m->resident;
+
+  __sync_synchronize();
+  p->sequence++;
+}
+
+/* A consistent copy of the page at [file_name], printed for a scraper */
+int metrics_read(const char *file_name, FILE *out, char *error){
+  struct metricsPageEx *page;
+  struct metricsPageEx copy;
+  struct stat st;
+  unsigned long before;
+  long spins;
+  int fd;
+
+  fd = open(file_name, O_RDONLY);
+  if(fd == -1){
+    sprintf(error, "\"%.512s\" could not be opened: %s\n", file_name, strerror(errno));
+    return -1;
+  }
+
+  if(fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(struct metricsPageEx)){
+    sprintf(error, "\"%.512s\" is not a tss metrics file.\n", file_name);
+    close(fd);
+    return -1;
+  }
+
+  page = mmap(NULL, sizeof(struct metricsPageEx), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(page == MAP_FAILED){
+    sprintf(error, "\"%.512s\" could not be mapped: %s\n", file_name, strerror(errno));
+    return -1;
+  }
+
+  for(spins = 0; spins < SPINS; spins++){
+    before = page->sequence;
+    __sync_synchronize();
+    memcpy(&copy, page, sizeof(struct metricsPageEx));
+    __sync_synchronize();
+    if(!(before & 1) && page->sequence == before && copy.magic == METRICS_MAGIC)
+      break;
+  }
+  munmap(page, sizeof(struct metricsPageEx));
+
+  if(spins == SPINS){
+    sprintf(error, "\"%.512s\" is not a tss metrics file, or it never "
+            "stopped changing.\n", file_name);
+    return -1;
+  }
+
+  /* It didn't get to say goodbye */
+  if(copy.running && kill(copy.pid, 0) == -1 && errno == ESRCH)
+    copy.running = 0;
+
+  fprintf(out, "# TYPE tss_up gauge\ntss_up %d\n", copy.running);
+  fprintf(out, "# TYPE tss_last_update_seconds gauge\n"
+          "tss_last_update_seconds %.3f\n", copy.updated);
+  fprintf(out, "# TYPE tss_frames_total counter\ntss_frames_total %ld\n", copy.frames);
+  fprintf(out, "# TYPE tss_frames_skipped_total counter\n"
+          "tss_frames_skipped_total %ld\n", copy.frames_skipped);
+  fprintf(out, "# TYPE tss_frames_dropped_total counter\n"
+          "tss_frames_dropped_total %ld\n", copy.frames_dropped);
+  if(copy.bytes_written >= 0)
+    fprintf(out, "# TYPE tss_written_bytes_total counter\n"
+            "tss_written_bytes_total %ld\n", copy.bytes_written);
+  fprintf(out, "# TYPE tss_frame_seconds summary\n");
+  fprintf(out, "tss_frame_seconds{quantile=\"0.5\"} %.4f\n", copy.frame_p50);
+  fprintf(out, "tss_frame_seconds{quantile=\"0.9\"} %.4f\n", copy.frame_p90);
+  fprintf(out, "tss_frame_seconds{quantile=\"0.99\"} %.4f\n", copy.frame_p99);
+  fprintf(out, "tss_frame_seconds{quantile=\"1\"} %.6f\n", copy.frame_max);
+  fprintf(out, "tss_frame_seconds_sum %.6f\n", copy.frame_average * copy.frames);
+  fprintf(out, "tss_frame_seconds_count %ld\n", copy.frames);
+  fprintf(out, "# TYPE tss_failed_unlocks_total counter\n"
+          "tss_failed_unlocks_total %ld\n", copy.failed_unlocks);
+  if(copy.vt_active >= 0)
+    fprintf(out, "# TYPE tss_vt_active gauge\ntss_vt_active %d\n", copy.vt_active);
+  if(copy.resident >= 0)
+    fprintf(out, "# TYPE tss_resident_bytes gauge\ntss_resident_bytes %ld\n", copy.resident);
+
+  return 0;
+}
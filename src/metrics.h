@@ -0,0 +1,68 @@
+/* Terminal ScreenSaver - live metrics page
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * With --metrics=FILE the frame statistics are kept in a small file mapped
+ * in to memory (put it in /dev/shm to keep it off the disk). Anything that
+ * maps the same file can read them without a single system call and
+ * without ever making tss wait: the page is guarded by a sequence counter
+ * which is odd while tss writes, so a reader simply tries again when the
+ * counter was odd or changed under it. tss --metrics-read=FILE does just
+ * that and prints the numbers in the Prometheus text format.
+ */
+
+#ifndef TSS_METRICS_H
+#define TSS_METRICS_H
+
+#include <stdio.h>
+
+#include "stats.h"
+
+#define METRICS_MAGIC		0x32737374UL	/* "tss2" */
+#define METRICS_SLOW		1.0	/* Seconds between reading RSS etc. */
+#define METRICS_ERROR_SIZE	600
+
+struct metricsPageEx{
+  unsigned long magic;
+  volatile unsigned long sequence;	/* Odd while being written */
+  long pid;
+  int running;
+  int vt_active;			/* 1 or 0; -1 when not on a VT */
+  double updated;			/* Seconds since the epoch */
+  long frames;
+  long frames_skipped;
+  long frames_dropped;
+  long bytes_written;			/* -1 when unknown */
+  long failed_unlocks;
+  long resident;			/* Bytes */
+  double frame_average;			/* Seconds */
+  double frame_p50;
+  double frame_p90;
+  double frame_p99;
+  double frame_max;
+};
+
+struct metricsEx{
+  int fd;
+  struct metricsPageEx *page;
+  int vt;				/* Our VT, 0 if not on one */
+  double slow_at;			/* When RSS etc. were last read */
+  int vt_active;
+  long bytes_written;
+  long resident;
+  double frame_p50;
+  double frame_p90;
+  double frame_p99;
+};
+
+struct metricsEx *metrics_open(const char *file_name, char *error);
+void metrics_close(struct metricsEx *m);
+void metrics_publish(struct metricsEx *m, struct statsEx *s,
+                     long failed_unlocks, double now);
+int metrics_read(const char *file_name, FILE *out, char *error);
+
+#endif
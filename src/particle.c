@@ -0,0 +1,174 @@
+/* Terminal ScreenSaver - particles
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * */
+
+#include <stdlib.h>
+
+#include "particle.h"
+#include "tick.h"
+
+#define CHECK_EVERY		256	/* Particles between clock reads */
+
+static float random_float(struct particlesEx *p){
+  p->seed = p->seed * 1103515245 + 12345;
+  return ((p->seed >> 8) & 0xffff) / 65536.0f;
+}
+
+struct particlesEx *particles_new(int capacity){
+  struct particlesEx *p;
+
+  p = calloc(1, sizeof(struct particlesEx));
+  if(p == NULL)
+    return NULL;
+
+  p->capacity	= capacity;
+  p->seed	= 0x2545f49;
+  p->x		= malloc(capacity * sizeof(float));
+  p->y		= malloc(capacity * sizeof(float));
+  p->vx		= malloc(capacity * sizeof(float));
+  p->vy		= malloc(capacity * sizeof(float));
+  p->age	= malloc(capacity * sizeof(float));
+  p->life	= malloc(capacity * sizeof(float));
+  p->kind	= malloc(capacity);
+  p->drawn	= malloc(capacity * sizeof(int));
+
+  if(p->x == NULL || p->y == NULL || p->vx == NULL || p->vy == NULL ||
+     p->age == NULL || p->life == NULL || p->kind == NULL || p->drawn == NULL){
+    particles_free(p);
+    return NULL;
+  }
+
+  return p;
+}
+
+void particles_free(struct particlesEx *p){
+  if(p == NULL)
+    return;
+
+  free(p->x);
+  free(p->y);
+  free(p->vx);
+  free(p->vy);
+  free(p->age);
+  free(p->life);
+  free(p->kind);
+  free(p->drawn);
+  free(p);
+}
+
+void particles_emit(struct particlesEx *p, int kind, float x, float y,
+                    float vx, float vy, float life){
+  int i;
+
+  if(p->count >= p->capacity || p->shedding){
+    p->dropped++;
+    return;
+  }
+
+  i = p->count++;
+  p->x[i]	= x;
+  p->y[i]	= y;
+  p->vx[i]	= vx;
+  p->vy[i]	= vy;
+  p->age[i]	= 0;
+  p->life[i]	= life;
+  p->kind[i]	= kind;
+  p->emitted++;
+}
+
+/* [n] sparks flying away from a wall; [dx], [dy] point away from it */
+void particles_burst(struct particlesEx *p, float x, float y, float dx, float dy, int n){
+  float speed;
+  int i;
+
+  for(i = 0; i < n; i++){
+    speed = 8 + random_float(p) * 16;
+    particles_emit(p, PARTICLE_SPARK, x, y,
+                   (dx != 0 ? dx : random_float(p) * 2 - 1) * speed,
+                   (dy != 0 ? dy : random_float(p) * 2 - 1) * speed * 0.5f,
+                   0.4f + random_float(p) * 0.8f);
+  }
+}
+
+/* Swap-remove: the last live particle takes the place of [i] */
+static void retire(struct particlesEx *p, int i){
+  int last = --p->count;
+
+  p->retired++;
+  p->retired_age += p->age[i];
+
+  p->x[i]	= p->x[last];
+  p->y[i]	= p->y[last];
+  p->vx[i]	= p->vx[last];
+  p->vy[i]	= p->vy[last];
+  p->age[i]	= p->age[last];
+  p->life[i]	= p->life[last];
+  p->kind[i]	= p->kind[last];
+}
+
+void particles_update(struct particlesEx *p, float dt, int width, int height){
+  double begin;
+  int i, n;
+
+  begin = tickcount();
+  p->shedding = 0;
+
+  for(i = 0, n = 0; i < p->count; n++){
+    /* Out of time: the rest die now rather than slowing the frame down */
+    if(n % CHECK_EVERY == CHECK_EVERY - 1 && tickcount() - begin > PARTICLE_BUDGET){
+      p->dropped += p->count - i;
+      while(p->count > i)
+        retire(p, p->count - 1);
+      p->shedding = 1;
+      break;
+    }
+
+    p->age[i] += dt;
+    p->x[i] += p->vx[i] * dt;
+    p->y[i] += p->vy[i] * dt;
+    if(p->kind[i] == PARTICLE_SPARK)
+      p->vy[i] += PARTICLE_GRAVITY * dt;
+
+    if(p->age[i] >= p->life[i] ||
+       p->x[i] < 0 || p->x[i] >= width || p->y[i] < 0 || p->y[i] >= height)
+      retire(p, i);
+    else
+      i++;
+  }
+
+  p->update_time = tickcount() - begin;
+  if(p->update_time > PARTICLE_BUDGET)
+    p->shedding = 1;
+}
+
+int particles_glyph(struct particlesEx *p, int i){
+  float f = p->age[i] / p->life[i];
+
+  if(p->kind[i] == PARTICLE_TRAIL)
+    return f < 0.5f ? ':' : '.';
+  return f < 0.3f ? '*' : f < 0.6f ? '+' : '.';
+}
+
+/* Classic color pairs: white, yellow, red for sparks; cyan, blue trails */
+int particles_color(struct particlesEx *p, int i){
+  float f = p->age[i] / p->life[i];
+
+  if(p->kind[i] == PARTICLE_TRAIL)
+    return f < 0.5f ? 7 : 5;
+  return f < 0.2f ? 8 : f < 0.5f ? 4 : 2;
+}
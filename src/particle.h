@@ -0,0 +1,54 @@
+/* Terminal ScreenSaver - particles
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Sparks and trails live in a pool of fixed size, allocated once. Each
+ * field is its own array, and a dead particle is replaced by the last
+ * live one, so the live particles are always the first [count] entries.
+ */
+
+#ifndef TSS_PARTICLE_H
+#define TSS_PARTICLE_H
+
+#define PARTICLE_SPARK		0
+#define PARTICLE_TRAIL		1
+
+#define PARTICLE_CAPACITY	2048
+#define PARTICLE_BUDGET		0.002	/* Seconds of update per frame */
+#define PARTICLE_GRAVITY	30.0f	/* Cells per second squared */
+
+struct particlesEx{
+  int capacity;
+  int count;			/* Live ones, the first [count] entries */
+  float *x;
+  float *y;
+  float *vx;			/* Cells per second */
+  float *vy;
+  float *age;			/* Seconds */
+  float *life;
+  unsigned char *kind;
+  int *drawn;			/* Offsets drawn last frame, for blanking */
+  int drawn_count;
+  unsigned int seed;
+  short shedding;		/* Over budget: no new particles this frame */
+  double update_time;		/* Seconds spent in the last update */
+  long emitted;
+  long dropped;			/* Pool full or over budget */
+  long retired;
+  double retired_age;		/* Sum of ages at death */
+};
+
+struct particlesEx *particles_new(int capacity);
+void particles_free(struct particlesEx *p);
+void particles_emit(struct particlesEx *p, int kind, float x, float y,
+                    float vx, float vy, float life);
+void particles_burst(struct particlesEx *p, float x, float y, float dx, float dy, int n);
+void particles_update(struct particlesEx *p, float dt, int width, int height);
+int particles_glyph(struct particlesEx *p, int i);
+int particles_color(struct particlesEx *p, int i);
+
+#endif
@@ -0,0 +1,216 @@
+/* Terminal ScreenSaver - output thread
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * Handing a frame over is one atomic exchange of r->ready, on either
+ * side. The semaphore only wakes the output thread up; it is posted when
+ * ready goes from taken to fresh, so it never counts more than a frame or
+ * two ahead. The lock is for pausing and stopping the thread, never for
+ * frames.
+ *
+ * */
+
+#define _XOPEN_SOURCE	500
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "render.h"
+#include "compose.h"
+
+/* Swap [slot] in to r->ready; returns what was there. The frame in [slot]
+ * is visible to whoever takes it next, and the one returned to us. */
+static unsigned int exchange(struct renderEx *r, unsigned int slot){
+  return __atomic_exchange_n(&r->ready, slot, __ATOMIC_ACQ_REL);
+}
+
+static int fresh(struct renderEx *r){
+  return __atomic_load_n(&r->ready, __ATOMIC_ACQUIRE) & RENDER_FRESH;
+}
+
+static int flag(int *f){
+  return __atomic_load_n(f, __ATOMIC_ACQUIRE);
+}
+
+static void set_flag(int *f, int value){
+  __atomic_store_n(f, value, __ATOMIC_RELEASE);
+}
+
+static void forget_front(struct renderEx *r){
+  long i;
+
+  for(i = 0; i < (long)r->width * r->height; i++)
+    r->front[i].ch = COMPOSE_UNKNOWN;
+}
+
+static void *render_main(void *arg){
+  struct renderEx *r = arg;
+
+  for(;;){
+    sem_wait(&r->wake);
+
+    if(flag(&r->pause) || flag(&r->quit)){
+      pthread_mutex_lock(&r->lock);
+      if(r->pause && !r->quit){
+        r->paused = 1;
+        pthread_cond_broadcast(&r->changed);
+        while(r->pause && !r->quit)
+          pthread_cond_wait(&r->changed, &r->lock);
+        r->paused = 0;
+      }
+      pthread_mutex_unlock(&r->lock);
+      if(flag(&r->quit))
+        break;
+    }
+
+    /* Woken up for a pause, or the frame was taken on the last round */
+    if(!fresh(r))
+      continue;
+
+    r->taken = exchange(r, r->taken) & RENDER_INDEX;
+    r->draw(r->context, r->slot[r->taken], r->front, r->width, r->height);
+    r->shown++;
+  }
+
+  return NULL;
+}
+
+struct renderEx *render_new(int width, int height, render_drawEx draw,
+                             void *context){
+  struct renderEx *r;
+  sigset_t all;
+  sigset_t old;
+  int failed;
+  int i;
+
+  r = calloc(1, sizeof(struct renderEx));
+  if(r == NULL)
+    return NULL;
+
+  r->width	= width;
+  r->height	= height;
+  r->draw	= draw;
+  r->context	= context;
+  r->front	= malloc((long)width * height * sizeof(struct cellEx));
+  failed	= r->front == NULL;
+  for(i = 0; i < RENDER_SLOTS; i++){
+    r->slot[i] = malloc((long)width * height * sizeof(struct cellEx));
+    failed |= r->slot[i] == NULL;
+  }
+  if(failed){
+    for(i = 0; i < RENDER_SLOTS; i++)
+      free(r->slot[i]);
+    free(r->front);
+    free(r);
+    return NULL;
+  }
+  forget_front(r);
+
+  r->back	= 0;
+  r->ready	= 1;
+  r->taken	= 2;
+  sem_init(&r->wake, 0, 0);
+  pthread_mutex_init(&r->lock, NULL);
+  pthread_cond_init(&r->changed, NULL);
+
+  /* Signals (VT switching) must keep going to the main thread */
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  failed = pthread_create(&r->thread, NULL, render_main, r) != 0;
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+  if(failed){
+    r->quit = 1;		/* No thread to join */
+    render_free(r);
+    return NULL;
+  }
+
+  return r;
+}
+
+void render_free(struct renderEx *r){
+  int i;
+
+  if(r == NULL)
+    return;
+
+  if(!r->quit){
+    pthread_mutex_lock(&r->lock);
+    set_flag(&r->quit, 1);
+    pthread_cond_broadcast(&r->changed);
+    pthread_mutex_unlock(&r->lock);
+    sem_post(&r->wake);
+    pthread_join(r->thread, NULL);
+  }
+
+  sem_destroy(&r->wake);
+  pthread_mutex_destroy(&r->lock);
+  pthread_cond_destroy(&r->changed);
+  for(i = 0; i < RENDER_SLOTS; i++)
+    free(r->slot[i]);
+  free(r->front);
+  free(r);
+}
+
+/* Queue a copy of [cells] for the terminal. Returns 1 when it replaced a
+ * frame the output thread never got to. */
+int render_publish(struct renderEx *r, struct cellEx *cells){
+  unsigned int old;
+
+  memcpy(r->slot[r->back], cells, (long)r->width * r->height * sizeof(struct cellEx));
+
+  old = exchange(r, r->back | RENDER_FRESH);
+  r->back = old & RENDER_INDEX;
+
+  if(old & RENDER_FRESH){
+    r->dropped++;
+    return 1;
+  }
+
+  sem_post(&r->wake);
+  return 0;
+}
+
+/* Returns once the output thread is between frames, and keeps it there
+ * until render_resume(); curses is all the caller's in the meantime */
+void render_pause(struct renderEx *r){
+  pthread_mutex_lock(&r->lock);
+  set_flag(&r->pause, 1);
+  pthread_mutex_unlock(&r->lock);
+  sem_post(&r->wake);
+
+  pthread_mutex_lock(&r->lock);
+  while(!r->paused)
+    pthread_cond_wait(&r->changed, &r->lock);
+  pthread_mutex_unlock(&r->lock);
+}
+
+void render_resume(struct renderEx *r){
+  pthread_mutex_lock(&r->lock);
+  set_flag(&r->pause, 0);
+  pthread_cond_broadcast(&r->changed);
+  pthread_mutex_unlock(&r->lock);
+}
+
+/* While paused: the screen was cleared, or palette indices changed
+ * meaning. Anything not drawn yet is thrown away, too. */
+void render_invalidate(struct renderEx *r){
+  __atomic_and_fetch(&r->ready, ~RENDER_FRESH, __ATOMIC_ACQ_REL);
+  forget_front(r);
+}
@@ -0,0 +1,64 @@
+/* Terminal ScreenSaver - output thread
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * With --render-thread, the main loop only moves things and composes
+ * frames; a thread of its own puts them on the terminal. Frames are
+ * handed over through three buffers without a lock: the main loop fills
+ * one, swaps it with the "ready" one, and the output thread swaps the
+ * ready one with its own whenever it is done with a frame. A frame the
+ * output thread had no time for is simply replaced by the next, so a
+ * terminal that can't keep up only ever shows fewer, newer frames.
+ */
+
+#ifndef TSS_RENDER_H
+#define TSS_RENDER_H
+
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "art.h"
+
+#define RENDER_SLOTS		3
+#define RENDER_FRESH		4	/* In ready: not taken yet */
+#define RENDER_INDEX		3
+
+/* Puts [cells] on the terminal; [front] is what it shows now. [context]
+ * is whatever was given to render_new(). */
+typedef void (*render_drawEx)(void *context, struct cellEx *cells,
+                              struct cellEx *front, int width, int height);
+
+struct renderEx{
+  int width;
+  int height;
+  struct cellEx *slot[RENDER_SLOTS];
+  struct cellEx *front;		/* On screen, owned by the output thread */
+  render_drawEx draw;
+  void *context;
+  unsigned int ready;		/* Slot | RENDER_FRESH; atomic */
+  int back;			/* Slot being filled by the main loop */
+  int taken;			/* Slot being drawn by the output thread */
+  long shown;
+  long dropped;
+  pthread_t thread;
+  sem_t wake;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  int pause;			/* Atomic, set under the lock */
+  int paused;
+  int quit;			/* Atomic, set under the lock */
+};
+
+struct renderEx *render_new(int width, int height, render_drawEx draw,
+                             void *context);
+void render_free(struct renderEx *r);
+int render_publish(struct renderEx *r, struct cellEx *cells);
+void render_pause(struct renderEx *r);
+void render_resume(struct renderEx *r);
+void render_invalidate(struct renderEx *r);
+
+#endif
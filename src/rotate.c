@@ -0,0 +1,246 @@
+/* Terminal ScreenSaver - ascii rotation
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * */
+
+#define _XOPEN_SOURCE	500
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "rotate.h"
+
+static pthread_t loader;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+
+static glob_t *list;
+static int file_count;		/* list->gl_pathc */
+static char *shown;		/* Files already used in this round */
+static int shown_count;
+static int current;
+static int orients;
+static int screen_w;
+static int screen_h;
+
+static unsigned long seed;	/* The loader's own; rand() is the main thread's */
+
+static short running;
+static short wanted;		/* Main thread wants a new object */
+static short ready;		/* ..and this one is it */
+static struct prefetchEx next;
+
+/* 0 .. n - 1 */
+static int pick_random(int n){
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % n;
+}
+
+/* Reservoir pick among the files not yet shown in this round. Once every
+ * file has had its turn, a new round starts; the file on screen is never
+ * picked twice in a row. */
+static int rotate_pick(void){
+  int pick;
+  int seen;
+  int i;
+
+  if(shown_count >= file_count){
+    memset(shown, 0, file_count);
+    shown_count = 0;
+    if(current >= 0 && file_count > 1){
+      shown[current] = 1;
+      shown_count++;
+    }
+  }
+
+  pick = -1;
+  seen = 0;
+  for(i = 0; i < file_count; i++){
+    if(shown[i])
+      continue;
+    if(pick_random(++seen) == 0)
+      pick = i;
+  }
+
+  if(pick == -1)
+    return current;
+
+  shown[pick] = 1;
+  shown_count++;
+  return pick;
+}
+
+static void release(struct prefetchEx *p){
+  int i;
+
+  for(i = 0; i < ART_ORIENTS; i++){
+    free(p->grid[i]);
+    p->grid[i] = NULL;
+  }
+  art_free(p->art);
+  p->art = NULL;
+}
+
+/* Never returns anything which will not fit the screen */
+static int prefetch(struct prefetchEx *p){
+  char error[ART_ERROR_SIZE];
+  int tries;
+  int pick;
+  int i;
+
+  for(tries = 0; tries < file_count; tries++){
+    pick = rotate_pick();
+    if(pick == current && file_count > 1)
+      continue;
+
+    p->file_name = list->gl_pathv[pick];
+    p->art = art_load(p->file_name, orients, error);
+    if(p->art == NULL)
+      continue;
+
+    if(p->art->width + 1 >= screen_w || p->art->height + 1 >= screen_h){
+      release(p);
+      continue;
+    }
+
+    for(i = 0; i < ART_ORIENTS; i++)
+      if(p->art->cell[i] != NULL){
+        p->grid[i] = art_grid_new(p->art, i);
+        if(p->grid[i] == NULL)
+          break;
+      }
+    if(i < ART_ORIENTS){
+      release(p);
+      continue;
+    }
+
+    current = pick;
+    return 0;
+  }
+
+  return -1;
+}
+
+static void *loader_main(void *arg){
+  struct prefetchEx p;
+
+  (void)arg;
+
+  pthread_mutex_lock(&lock);
+  while(running){
+    while(running && !wanted)
+      pthread_cond_wait(&wake, &lock);
+    if(!running)
+      break;
+    wanted = 0;
+    pthread_mutex_unlock(&lock);
+
+    /* Disk and NFS stalls happen here, not in the render loop */
+    memset(&p, 0, sizeof(p));
+    if(prefetch(&p) == -1)
+      p.art = NULL;
+
+    pthread_mutex_lock(&lock);
+    if(p.art != NULL){
+      next = p;
+      ready = 1;
+    }
+  }
+  pthread_mutex_unlock(&lock);
+
+  return NULL;
+}
+
+int rotate_init(glob_t *files, int file, int orient_mask, int max_width, int max_height){
+  sigset_t all;
+  sigset_t old;
+  int ret;
+
+  list		= files;
+  file_count	= files->gl_pathc;
+  current	= file;
+  orients	= orient_mask;
+  screen_w	= max_width;
+  screen_h	= max_height;
+  shown_count	= 0;
+  seed		= rand();
+  memset(&next, 0, sizeof(next));
+
+  shown = calloc(file_count + 1, 1);
+  if(shown == NULL)
+    return -1;
+  if(current >= 0){
+    shown[current] = 1;
+    shown_count = 1;
+  }
+
+  running	= 1;
+  wanted	= 1;
+  ready		= 0;
+
+  /* Signals (VT switching) must keep going to the main thread */
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  ret = pthread_create(&loader, NULL, loader_main, NULL);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+  if(ret != 0){
+    running = 0;
+    free(shown);
+    shown = NULL;
+    return -1;
+  }
+
+  return 0;
+}
+
+/* Hand over the prefetched object, if there is one, and start loading the
+ * one after it. Never blocks on I/O. */
+int rotate_take(struct prefetchEx *p){
+  int got;
+
+  got = 0;
+  pthread_mutex_lock(&lock);
+  if(ready){
+    *p = next;
+    memset(&next, 0, sizeof(next));
+    ready = 0;
+    wanted = 1;
+    got = 1;
+    pthread_cond_signal(&wake);
+  }
+  pthread_mutex_unlock(&lock);
+
+  return got;
+}
+
+void rotate_stop(void){
+  if(shown == NULL)
+    return;
+
+  pthread_mutex_lock(&lock);
+  running = 0;
+  pthread_cond_signal(&wake);
+  pthread_mutex_unlock(&lock);
+  pthread_join(loader, NULL);
+
+  release(&next);
+  free(shown);
+  shown = NULL;
+}
@@ -0,0 +1,31 @@
+/* Terminal ScreenSaver - ascii rotation
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The next ascii object is read, compiled and mirrored by a loader thread
+ * while the current one is on screen. At most two objects are held at
+ * any time: the one being shown and the one waiting to replace it.
+ */
+
+#ifndef TSS_ROTATE_H
+#define TSS_ROTATE_H
+
+#include <glob.h>
+
+#include "art.h"
+
+struct prefetchEx{
+  struct artEx *art;
+  struct cellEx *grid[ART_ORIENTS];
+  char *file_name;		/* Points in to the glob list */
+};
+
+int rotate_init(glob_t *files, int current, int orients, int max_width, int max_height);
+int rotate_take(struct prefetchEx *next);
+void rotate_stop(void);
+
+#endif
@@ -0,0 +1,309 @@
+/* Terminal ScreenSaver - ascii shared between processes
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * A copy is a header followed by the arrays of struct artEx, each at an
+ * offset which is a multiple of 8. It is written to a file of its own
+ * and renamed in to place when complete, read only, so a copy which can
+ * be opened never changes; one made for a changed file replaces it
+ * without disturbing anyone who still has the old one mapped.
+ *
+ * Nothing in a copy is trusted before it was checked: it has to belong
+ * to us, match the checksum and the file, and every index in it has to
+ * be in range, as art_parse() would have made it.
+ *
+ * */
+
+#define _XOPEN_SOURCE	700		/* st_mtim */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "share.h"
+#include "transform.h"
+
+#define ALIGN(n)		(((n) + 7) & ~7L)
+#define LAYOUT			((long)sizeof(struct cellEx) | \
+				 (long)sizeof(struct deltaEx) << 8 | \
+				 (long)sizeof(struct frameEx) << 16 | \
+				 (long)sizeof(struct paletteEx) << 24)
+#define PATH_SIZE		128
+
+/* A file changed twice in one second has to count as changed */
+#ifdef BSD
+#define MTIME_NSEC(st)		((st)->st_mtimespec.tv_nsec)
+#define CTIME_NSEC(st)		((st)->st_ctimespec.tv_nsec)
+#else
+#define MTIME_NSEC(st)		((st)->st_mtim.tv_nsec)
+#define CTIME_NSEC(st)		((st)->st_ctim.tv_nsec)
+#endif
+
+static int enabled;
+
+/* Called before any other thread might load ascii */
+void share_enable(void){
+  enabled = 1;
+}
+
+static void path(char *to, struct stat *file, int orients){
+  sprintf(to, "%s/tss-%d-%lx-%lx-%x-%lx.art", SHARE_DIR, (int)geteuid(),
+          (unsigned long)file->st_dev, (unsigned long)file->st_ino, orients,
+          transform_checksum());
+}
+
+/* FNV-1a, a word at a time; [length] is a multiple of 8 */
+static unsigned long checksum(const void *data, long length){
+  const unsigned int *word;
+  unsigned long sum;
+  long i;
+
+  word = data;
+  sum = 2166136261UL;
+  for(i = 0; i < length / (long)sizeof(unsigned int); i++)
+    sum = (sum ^ word[i]) * 16777619UL;
+  return sum;
+}
+
+static int fits(struct shareHeaderEx *h, long offset, long count, long size){
+  if(offset == 0)
+    return 1;
+  return offset >= (long)sizeof(struct shareHeaderEx) && count >= 0 &&
+         offset % 8 == 0 && offset <= h->size && count <= (h->size - offset) / size;
+}
+
+static int valid_cell(struct shareHeaderEx *h, struct cellEx *cell){
+  return cell->color < h->palette_count && cell->width <= 2;
+}
+
+/* Everything in range, as art_parse() would have made it */
+static int valid(struct shareHeaderEx *h){
+  struct cellEx *cell;
+  struct deltaEx *delta;
+  struct frameEx *frame;
+  long cells;
+  long i;
+  int o;
+
+  if(h->width < 1 || h->height < 1 || h->frame_count < 1 || h->delta_count < 0 ||
+     h->palette_count <= ART_LEGACY_COLORS || h->palette_count > ART_MAX_COLORS ||
+     h->tail_color >= h->palette_count || h->height > (long)MAX_ASCII_SIZE / h->width)
+    return 0;
+  cells = (long)h->width * h->height;
+
+  if(h->frame == 0 || h->palette == 0 || h->cell[ART_NORMAL] == 0 ||
+     !fits(h, h->frame, h->frame_count, sizeof(struct frameEx)) ||
+     !fits(h, h->palette, h->palette_count, sizeof(struct paletteEx)))
+    return 0;
+
+  frame = (struct frameEx *)((char *)h + h->frame);
+  for(i = 0; i < h->frame_count; i++)
+    if(frame[i].delta_first < 0 || frame[i].delta_count < 0 ||
+       frame[i].delta_first > h->delta_count ||
+       frame[i].delta_count > h->delta_count - frame[i].delta_first)
+      return 0;
+
+  for(o = 0; o < ART_ORIENTS; o++){
+    if((h->cell[o] != 0) != ((h->built & 1 << o) != 0) ||
+       !fits(h, h->cell[o], cells, sizeof(struct cellEx)) ||
+       !fits(h, h->delta[o], h->delta_count, sizeof(struct deltaEx)))
+      return 0;
+    if(h->frame_count > 1 && h->delta_count > 0 && h->cell[o] != 0 && h->delta[o] == 0)
+      return 0;
+
+    cell = (struct cellEx *)((char *)h + h->cell[o]);
+    for(i = 0; h->cell[o] != 0 && i < cells; i++)
+      if(!valid_cell(h, &cell[i]))
+        return 0;
+
+    delta = (struct deltaEx *)((char *)h + h->delta[o]);
+    for(i = 0; h->delta[o] != 0 && i < h->delta_count; i++)
+      if(delta[i].offset < 0 || delta[i].offset >= cells || !valid_cell(h, &delta[i].cell))
+        return 0;
+  }
+
+  return 1;
+}
+
+/* The copy of the ascii in [file], mapped, or NULL if there is none which
+ * is still good */
+struct artEx *share_find(struct stat *file, int orients){
+  struct shareHeaderEx *h;
+  struct artEx *art;
+  struct stat st;
+  char name[PATH_SIZE];
+  void *map;
+  int fd;
+  int o;
+
+  if(!enabled)
+    return NULL;
+
+  path(name, file, orients);
+  fd = open(name, O_RDONLY);
+  if(fd == -1)
+    return NULL;
+  if(fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_uid != geteuid() ||
+     st.st_size < (long)sizeof(struct shareHeaderEx)){
+    close(fd);
+    return NULL;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+    return NULL;
+
+  h = map;
+  if(memcmp(h->magic, SHARE_MAGIC, sizeof(h->magic)) != 0 || h->size != st.st_size ||
+     h->layout != LAYOUT || h->orients != orients || h->transform != transform_checksum() ||
+     h->dev != (long)file->st_dev || h->ino != (long)file->st_ino ||
+     h->mtime != (long)file->st_mtime || h->mtime_nsec != (long)MTIME_NSEC(file) ||
+     h->ctime != (long)file->st_ctime || h->ctime_nsec != (long)CTIME_NSEC(file) ||
+     h->file_size != (long)file->st_size ||
+     h->size % 8 != 0 ||
+     h->checksum != checksum((char *)map + sizeof(struct shareHeaderEx),
+                             h->size - sizeof(struct shareHeaderEx)) ||
+     !valid(h) ||
+     (art = calloc(1, sizeof(struct artEx))) == NULL){
+    munmap(map, st.st_size);
+    return NULL;
+  }
+
+  for(o = 0; o < ART_ORIENTS; o++){
+    art->cell[o]	= h->cell[o] ? (struct cellEx *)((char *)map + h->cell[o]) : NULL;
+    art->delta[o]	= h->delta[o] ? (struct deltaEx *)((char *)map + h->delta[o]) : NULL;
+  }
+  art->frame		= (struct frameEx *)((char *)map + h->frame);
+  art->palette		= (struct paletteEx *)((char *)map + h->palette);
+  art->palette_count	= h->palette_count;
+  art->frame_count	= h->frame_count;
+  art->delta_count	= h->delta_count;
+  art->width		= h->width;
+  art->height		= h->height;
+  art->mirror		= h->mirror;
+  art->orients		= h->built;
+  art->forced_direction	= h->forced_direction;
+  art->tail_color	= h->tail_color;
+  art->shared		= map;
+  art->shared_size	= h->size;
+
+  return art;
+}
+
+/* Copy [from] ([count] of [size] bytes) to [at] in [h]; its offset, or 0
+ * for NULL */
+static long put(struct shareHeaderEx *h, long *at, const void *from, long count, long size){
+  long offset;
+
+  if(from == NULL)
+    return 0;
+  offset = *at;
+  memcpy((char *)h + offset, from, count * size);
+  *at += ALIGN(count * size);
+  return offset;
+}
+
+/* Leave a copy of [art], just loaded from [file], for the others. Failing
+ * is no error; there will simply be no copy. */
+void share_publish(struct stat *file, int orients, struct artEx *art){
+  struct shareHeaderEx *h;
+  char name[PATH_SIZE];
+  char temporary[PATH_SIZE + 32];
+  long cells;
+  long size;
+  long at;
+  long n;
+  long done;
+  int fd;
+  int o;
+
+  if(!enabled || art->shared != NULL)
+    return;
+
+  cells = (long)art->width * art->height;
+  size = ALIGN(sizeof(struct shareHeaderEx)) +
+         ALIGN(art->frame_count * sizeof(struct frameEx)) +
+         ALIGN(art->palette_count * sizeof(struct paletteEx));
+  for(o = 0; o < ART_ORIENTS; o++){
+    if(art->cell[o] != NULL)
+      size += ALIGN(cells * sizeof(struct cellEx));
+    if(art->delta[o] != NULL)
+      size += ALIGN(art->delta_count * sizeof(struct deltaEx));
+  }
+
+  h = calloc(1, size);
+  if(h == NULL)
+    return;
+
+  memcpy(h->magic, SHARE_MAGIC, sizeof(h->magic));
+  h->size		= size;
+  h->layout		= LAYOUT;
+  h->dev		= file->st_dev;
+  h->ino		= file->st_ino;
+  h->mtime		= file->st_mtime;
+  h->mtime_nsec		= MTIME_NSEC(file);
+  h->ctime		= file->st_ctime;
+  h->ctime_nsec		= CTIME_NSEC(file);
+  h->file_size		= file->st_size;
+  h->transform		= transform_checksum();
+  h->orients		= orients;
+  h->palette_count	= art->palette_count;
+  h->frame_count	= art->frame_count;
+  h->delta_count	= art->delta_count;
+  h->width		= art->width;
+  h->height		= art->height;
+  h->mirror		= art->mirror;
+  h->built		= art->orients;
+  h->forced_direction	= art->forced_direction;
+  h->tail_color		= art->tail_color;
+
+  at = ALIGN(sizeof(struct shareHeaderEx));
+  h->frame	= put(h, &at, art->frame, art->frame_count, sizeof(struct frameEx));
+  h->palette	= put(h, &at, art->palette, art->palette_count, sizeof(struct paletteEx));
+  for(o = 0; o < ART_ORIENTS; o++){
+    h->cell[o]	= put(h, &at, art->cell[o], cells, sizeof(struct cellEx));
+    h->delta[o]	= put(h, &at, art->delta[o], art->delta_count, sizeof(struct deltaEx));
+  }
+  h->checksum = checksum((char *)h + sizeof(struct shareHeaderEx),
+                         size - sizeof(struct shareHeaderEx));
+
+  path(name, file, orients);
+  sprintf(temporary, "%s.%d", name, (int)getpid());
+  fd = open(temporary, O_WRONLY | O_CREAT | O_EXCL, 0400);
+  if(fd == -1){
+    free(h);
+    return;
+  }
+
+  for(done = 0; done < size; done += n){
+    n = write(fd, (char *)h + done, size - done);
+    if(n <= 0)
+      break;
+  }
+  free(h);
+
+  if(close(fd) == -1 || done < size || rename(temporary, name) == -1)
+    unlink(temporary);
+}
+
+void share_unmap(struct artEx *art){
+  munmap(art->shared, art->shared_size);
+}
@@ -0,0 +1,66 @@
+/* Terminal ScreenSaver - ascii shared between processes
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * With --share-art, the first tss to load an ascii file leaves the loaded
+ * cells, frames and palette, mirrored copies and all, in /dev/shm. Every
+ * other tss of the same user maps that read only instead of loading the
+ * file again. A copy belongs to one file (device and inode) and is only
+ * used while the file's time and size are still the ones it was made
+ * from, and only by a tss with the same mirror maps, which the mirrored
+ * copies were made with; a changed file gets a new copy in place of the
+ * old.
+ */
+
+#ifndef TSS_SHARE_H
+#define TSS_SHARE_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "art.h"
+
+#define SHARE_DIR		"/dev/shm"
+#define SHARE_MAGIC		"tssart2"
+
+struct shareHeaderEx{
+  char magic[8];
+  unsigned long checksum;	/* Of everything after it */
+  long size;			/* Header included */
+  long layout;			/* Sizes of the structures below */
+  long dev;			/* The file it was loaded from */
+  long ino;
+  long mtime;
+  long mtime_nsec;
+  long ctime;
+  long ctime_nsec;
+  long file_size;
+  unsigned long transform;	/* transform_checksum() */
+  int orients;			/* As asked for */
+
+  int palette_count;
+  int frame_count;
+  int delta_count;
+  int width;
+  int height;
+  short mirror;
+  short built;			/* art->orients */
+  short forced_direction;
+  unsigned short tail_color;
+
+  long cell[ART_ORIENTS];	/* Offsets, 0 if not there */
+  long delta[ART_ORIENTS];
+  long frame;
+  long palette;
+};
+
+void share_enable(void);
+struct artEx *share_find(struct stat *file, int orients);
+void share_publish(struct stat *file, int orients, struct artEx *art);
+void share_unmap(struct artEx *art);
+
+#endif
@@ -0,0 +1,124 @@
+/* Terminal ScreenSaver - frame statistics
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * */
+
+#include "stats.h"
+
+/* One frame took [seconds], not counting the sleep */
+void stats_frame(struct statsEx *s, double seconds){
+  long bucket;
+
+  s->frames++;
+  if(s->frame_budget > 0 && seconds > s->frame_budget)
+    s->frames_skipped++;
+
+  bucket = seconds / STATS_BUCKET;
+  if(bucket < 0)
+    bucket = 0;			/* The clock was set back */
+  s->frame_histogram[bucket < STATS_BUCKETS ? bucket : STATS_BUCKETS]++;
+
+  s->frame_last = seconds;
+  s->frame_time += seconds;
+  if(seconds > s->frame_time_max)
+    s->frame_time_max = seconds;
+}
+
+/* Frame time, in seconds, that [percent] of all frames stayed within;
+ * rounded up to the next 0.1 ms */
+double stats_percentile(struct statsEx *s, double percent){
+  long want, seen;
+  int i;
+
+  if(s->frames == 0)
+    return 0;
+
+  want = s->frames * percent / 100;
+  if(want < 1)
+    want = 1;
+
+  seen = 0;
+  for(i = 0; i < STATS_BUCKETS; i++){
+    seen += s->frame_histogram[i];
+    if(seen >= want)
+      return (i + 1) * STATS_BUCKET;
+  }
+
+  return s->frame_time_max;
+}
+
+void stats_particles(struct statsEx *s, struct particlesEx *p){
+  s->particles		= p->count;
+  s->particles_emitted	= p->emitted;
+  s->particles_dropped	= p->dropped;
+  if(p->count > s->particles_peak)
+    s->particles_peak	= p->count;
+  if(p->retired > 0)
+    s->particle_life	= p->retired_age / p->retired;
+
+  s->particle_time += p->update_time;
+  if(p->update_time > s->particle_time_max)
+    s->particle_time_max = p->update_time;
+}
+
+void stats_print(struct statsEx *s, FILE *out){
+  if(s->frames == 0)
+    return;
+
+  fprintf(out, "%ld frames, %.3f ms average, %.1f ms median, "
+          "%.1f ms 99th percentile, %.3f ms worst.\n",
+          s->frames, 1000 * s->frame_time / s->frames,
+          1000 * stats_percentile(s, 50), 1000 * stats_percentile(s, 99),
+          1000 * s->frame_time_max);
+  if(s->frames_skipped > 0)
+    fprintf(out, "%ld frames took longer than the delay between frames.\n",
+            s->frames_skipped);
+  if(s->frames_dropped > 0)
+    fprintf(out, "%ld frames were replaced by newer ones before they were written.\n",
+            s->frames_dropped);
+
+  if(s->particles_emitted == 0)
+    return;
+
+  fprintf(out, "%ld particles (%d at most at once, %ld dropped), "
+          "%.2f s average lifetime.\n",
+          s->particles_emitted, s->particles_peak, s->particles_dropped,
+          s->particle_life);
+  fprintf(out, "Particle update %.3f ms average, %.3f ms worst.\n",
+          1000 * s->particle_time / s->frames, 1000 * s->particle_time_max);
+}
+
+void stats_phase(struct phasesEx *p, const char *name, double now){
+  if(p->count >= STATS_PHASES)
+    return;
+
+  p->name[p->count] = name;
+  p->at[p->count] = now;
+  p->count++;
+}
+
+void stats_print_phases(struct phasesEx *p, FILE *out){
+  int i;
+
+  if(p->count < 2)
+    return;
+
+  fprintf(out, "Startup:\n");
+  for(i = 1; i < p->count; i++)
+    fprintf(out, "  %-24s %8.3f ms\n", p->name[i], 1000 * (p->at[i] - p->at[i - 1]));
+  fprintf(out, "  %-24s %8.3f ms\n", "total", 1000 * (p->at[p->count - 1] - p->at[0]));
+}
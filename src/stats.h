@@ -0,0 +1,57 @@
+/* Terminal ScreenSaver - frame statistics
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Running totals of what each frame cost, kept by the main loop and
+ * printed on exit with --stats, and what startup cost (--time-startup).
+ */
+
+#ifndef TSS_STATS_H
+#define TSS_STATS_H
+
+#include <stdio.h>
+
+#include "particle.h"
+
+#define STATS_BUCKETS		1000	/* Frame times, 0.1 ms each */
+#define STATS_BUCKET		0.0001
+
+struct statsEx{
+  long frames;
+  long frames_skipped;		/* Took longer than frame_budget */
+  long frames_dropped;		/* Replaced before an output thread drew them */
+  double frame_budget;		/* Seconds between frames */
+  double frame_time;		/* Seconds, summed over all frames */
+  double frame_time_max;
+  double frame_last;		/* Seconds, last frame */
+  long frame_histogram[STATS_BUCKETS + 1];	/* Last one: 100 ms or more */
+  int particles;		/* Live now */
+  int particles_peak;
+  long particles_emitted;
+  long particles_dropped;
+  double particle_life;		/* Average age at death, seconds */
+  double particle_time;		/* Update seconds, summed */
+  double particle_time_max;
+};
+
+#define STATS_PHASES		16
+
+/* Startup, phase by phase; the first mark is the starting point */
+struct phasesEx{
+  int count;
+  const char *name[STATS_PHASES];
+  double at[STATS_PHASES];	/* Seconds, when the phase ended */
+};
+
+void stats_frame(struct statsEx *s, double seconds);
+double stats_percentile(struct statsEx *s, double percent);
+void stats_particles(struct statsEx *s, struct particlesEx *p);
+void stats_print(struct statsEx *s, FILE *out);
+void stats_phase(struct phasesEx *p, const char *name, double now);
+void stats_print_phases(struct phasesEx *p, FILE *out);
+
+#endif
@@ -0,0 +1,36 @@
+/* Terminal ScreenSaver - wall clock
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * The main loop, the loaders and the effects all time themselves against
+ * the same clock, so it lives on its own rather than in main.c, where the
+ * modules (and anything linking them without main) can't reach it.
+ *
+ * */
+
+#include <sys/time.h>
+
+#include "tick.h"
+
+double tickcount(void){
+  struct timeval tick;
+  double time;
+  gettimeofday(&tick, 0);
+  time = (double) tick.tv_sec + ((double) tick.tv_usec) / 1000000;
+  return time;
+}
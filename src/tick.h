@@ -0,0 +1,16 @@
+/* Terminal ScreenSaver - wall clock
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef TSS_TICK_H
+#define TSS_TICK_H
+
+/* Seconds since the epoch, to the microsecond */
+double tickcount(void);
+
+#endif
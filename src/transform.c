@@ -0,0 +1,293 @@
+/* Terminal ScreenSaver - glyph transforms
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * Map file format, one pair per line, '#' starts a comment:
+ *
+ *  h <a> <b>		<a> and <b> swap when mirrored
+ *  v <a> <b>		<a> and <b> swap when flipped upside down
+ *
+ * Characters are given as UTF-8 or as U+XXXX.
+ *
+ * */
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "art.h"
+#include "utf8.h"
+#include "transform.h"
+
+#define HIGH_SIZE		1024	/* Power of 2 */
+
+struct highEx{
+  unsigned int cp;		/* 0 is a free slot */
+  unsigned int to[ART_ORIENTS];
+};
+
+/* Code points below 256 are looked up directly, the rest are hashed */
+static unsigned int low[ART_ORIENTS][256];
+static struct highEx high[HIGH_SIZE];
+static unsigned long sum;		/* Of both tables, see transform_checksum() */
+
+/* Mirrorable characters */
+static const unsigned int mirrorchr[][2] = {
+  {'/', '\\'}, {'(', ')'}, {'<', '>'}, {'{', '}'}, {'[', ']'}, {'b', 'd'},
+  {'`', '\''},
+  {0x00AB, 0x00BB},	/* « » */
+  {0x2039, 0x203A},	/* ‹ › */
+  {0x2190, 0x2192},	/* ← → */
+  {0x2571, 0x2572},	/* ╱ ╲ */
+  {0x250C, 0x2510},	/* ┌ ┐ */
+  {0x2514, 0x2518},	/* └ ┘ */
+  {0x251C, 0x2524},	/* ├ ┤ */
+  {0x2554, 0x2557},	/* ╔ ╗ */
+  {0x255A, 0x255D},	/* ╚ ╝ */
+  {0x2560, 0x2563},	/* ╠ ╣ */
+  {0x256D, 0x256E},	/* ╭ ╮ */
+  {0x2570, 0x256F},	/* ╰ ╯ */
+  {0x258C, 0x2590},	/* ▌ ▐ */
+  {0x25C0, 0x25B6},	/* ◀ ▶ */
+  {0x25C4, 0x25BA},	/* ◄ ► */
+  {0x27E8, 0x27E9},	/* ⟨ ⟩ */
+  {0x300C, 0x300D},	/* 「 」 */
+  {0, 0}
+};
+
+/* Flippable characters */
+static const unsigned int flipchr[][2] = {
+  {'/', '\\'}, {'^', 'v'}, {'_', 0x203E}, {'\'', ','}, {'.', '`'},
+  {'M', 'W'}, {'b', 'p'}, {'d', 'q'}, {'n', 'u'},
+  {0x2571, 0x2572},	/* ╱ ╲ */
+  {0x250C, 0x2514},	/* ┌ └ */
+  {0x2510, 0x2518},	/* ┐ ┘ */
+  {0x252C, 0x2534},	/* ┬ ┴ */
+  {0x2554, 0x255A},	/* ╔ ╚ */
+  {0x2557, 0x255D},	/* ╗ ╝ */
+  {0x2566, 0x2569},	/* ╦ ╩ */
+  {0x256D, 0x2570},	/* ╭ ╰ */
+  {0x256E, 0x256F},	/* ╮ ╯ */
+  {0x2580, 0x2584},	/* ▀ ▄ */
+  {0x25B2, 0x25BC},	/* ▲ ▼ */
+  {0x2191, 0x2193},	/* ↑ ↓ */
+  {0x2227, 0x2228},	/* ∧ ∨ */
+  {0, 0}
+};
+
+static struct highEx *find(unsigned int cp, int add){
+  unsigned int h;
+  int i, o;
+
+  h = (cp * 2654435761U) & (HIGH_SIZE - 1);
+  for(i = 0; i < HIGH_SIZE; i++, h = (h + 1) & (HIGH_SIZE - 1)){
+    if(high[h].cp == cp)
+      return &high[h];
+    if(high[h].cp == 0){
+      if(!add)
+        return NULL;
+      high[h].cp = cp;
+      for(o = 0; o < ART_ORIENTS; o++)
+        high[h].to[o] = cp;
+      return &high[h];
+    }
+  }
+
+  return NULL;
+}
+
+unsigned int transform_glyph(int orient, unsigned int cp){
+  struct highEx *e;
+
+  if(cp < 256)
+    return low[orient][cp];
+
+  e = find(cp, 0);
+  return e ? e->to[orient] : cp;
+}
+
+/* Record that [a] and [b] swap along [axis] (ART_MIRROR or ART_FLIP) */
+static int add_pair(int axis, unsigned int a, unsigned int b){
+  struct highEx *e;
+
+  if(a < 256){
+    low[axis][a] = b;
+  }else{
+    if((e = find(a, 1)) == NULL)
+      return -1;
+    e->to[axis] = b;
+  }
+
+  if(b < 256){
+    low[axis][b] = a;
+  }else{
+    if((e = find(b, 1)) == NULL)
+      return -1;
+    e->to[axis] = a;
+  }
+
+  return 0;
+}
+
+/* FNV-1a over [length] bytes of [data], continuing from [h] */
+static unsigned long fnv(unsigned long h, const void *data, long length){
+  const unsigned char *byte;
+  long i;
+
+  byte = data;
+  for(i = 0; i < length; i++)
+    h = ((h ^ byte[i]) * 16777619UL) & 0xffffffffUL;
+  return h;
+}
+
+/* Both ways at once: mirror, then flip */
+static void combine(void){
+  int i;
+
+  for(i = 0; i < 256; i++)
+    low[ART_MIRROR | ART_FLIP][i] = 
+      transform_glyph(ART_FLIP, transform_glyph(ART_MIRROR, i));
+
+  for(i = 0; i < HIGH_SIZE; i++)
+    if(high[i].cp != 0)
+      high[i].to[ART_MIRROR | ART_FLIP] = 
+        transform_glyph(ART_FLIP, transform_glyph(ART_MIRROR, high[i].cp));
+
+  sum = fnv(fnv(2166136261UL, low, sizeof(low)), high, sizeof(high));
+}
+
+/* Changes with the tables, so a copy of transformed ascii (see share.h)
+ * made with other maps is told apart */
+unsigned long transform_checksum(void){
+  return sum;
+}
+
+void transform_init(void){
+  int o, i;
+
+  for(o = 0; o < ART_ORIENTS; o++)
+    for(i = 0; i < 256; i++)
+      low[o][i] = i;
+  memset(high, 0, sizeof(high));
+
+  for(i = 0; mirrorchr[i][0] != 0; i++)
+    add_pair(ART_MIRROR, mirrorchr[i][0], mirrorchr[i][1]);
+  for(i = 0; flipchr[i][0] != 0; i++)
+    add_pair(ART_FLIP, flipchr[i][0], flipchr[i][1]);
+
+  combine();
+}
+
+/* One character, as UTF-8 or U+XXXX. Returns the bytes used or 0. */
+static int parse_char(char *p, unsigned int *cp){
+  char *end;
+
+  if((p[0] == 'U' || p[0] == 'u') && p[1] == '+'){
+    *cp = strtoul(&p[2], &end, 16);
+    return end - p;
+  }
+
+  return utf8_decode(p, strlen(p), cp);
+}
+
+/* Whether [cp] can be swapped: not a control character or a space */
+static int visible(unsigned int cp){
+  if(cp <= 0x20 || (cp >= 0x7f && cp <= 0xa0) || cp > 0x10ffff)
+    return 0;
+  if(cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200a) || cp == 0x2028 || cp == 0x2029
+      || cp == 0x202f || cp == 0x205f || cp == 0x3000 || cp == 0xfeff)
+    return 0;
+  return 1;
+}
+
+/* Read "<char> <char>" after an axis letter into [a] and [b]. Returns 0,
+ * or -1 when the line holds anything else. */
+static int parse_pair(char *p, unsigned int *a, unsigned int *b){
+  int n;
+
+  if(*p != ' ' && *p != '\t')
+    return -1;
+  for(; *p == ' ' || *p == '\t'; p++);
+
+  n = parse_char(p, a);
+  if(n == 0 || !visible(*a))
+    return -1;
+  p += n;
+
+  if(*p != ' ' && *p != '\t')
+    return -1;
+  for(; *p == ' ' || *p == '\t'; p++);
+
+  n = parse_char(p, b);
+  if(n == 0 || !visible(*b))
+    return -1;
+  p += n;
+
+  for(; *p == ' ' || *p == '\t' || *p == '\r'; p++);
+  if(*p != '#' && *p != '\n' && *p != '\0')
+    return -1;
+  return 0;
+}
+
+/* Add the pairs in [file_name] to the tables */
+int transform_load(const char *file_name, char *error){
+  FILE *fd;
+  char line[256];
+  char *p;
+  unsigned int a, b;
+  int axis;
+  int number;
+
+  fd = fopen(file_name, "r");
+  if(!fd){
+    sprintf(error, "\"%.512s\" could not be read: %s\n", file_name, strerror(errno));
+    return -1;
+  }
+
+  number = 0;
+  while(fgets(line, sizeof(line), fd) != NULL){
+    number++;
+
+    for(p = line; *p == ' ' || *p == '\t'; p++);
+    if(*p == '#' || *p == '\n' || *p == '\0')
+      continue;
+
+    switch(*p++){
+    case 'h': axis = ART_MIRROR; break;
+    case 'v': axis = ART_FLIP; break;
+    default: axis = 0;
+    }
+
+    if(axis == 0 || parse_pair(p, &a, &b) == -1){
+      sprintf(error, "%.512s:%d: expected \"h|v <char> <char>\"\n", file_name, number);
+      fclose(fd);
+      return -1;
+    }
+
+    if(add_pair(axis, a, b) == -1){
+      sprintf(error, "%.512s:%d: too many characters\n", file_name, number);
+      fclose(fd);
+      return -1;
+    }
+  }
+
+  fclose(fd);
+  combine();
+  return 0;
+}
@@ -0,0 +1,24 @@
+/* Terminal ScreenSaver - glyph transforms
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Lookup tables for what a character turns in to when the object is
+ * mirrored (horizontal), flipped (vertical) or both. Set up once at start;
+ * read only afterwards, so the loader thread may use them freely.
+ */
+
+#ifndef TSS_TRANSFORM_H
+#define TSS_TRANSFORM_H
+
+#define TRANSFORM_ERROR_SIZE	1024
+
+void transform_init(void);
+int transform_load(const char *file_name, char *error);
+unsigned int transform_glyph(int orient, unsigned int cp);
+unsigned long transform_checksum(void);
+
+#endif
@@ -0,0 +1,17 @@
+/* Terminal ScreenSaver - UTF-8 and display widths
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef TSS_UTF8_H
+#define TSS_UTF8_H
+
+int utf8_decode(const char *data, long length, unsigned int *cp);
+int utf8_encode(unsigned int cp, char *buf);
+int utf8_width(unsigned int cp);
+
+#endif
@@ -0,0 +1,346 @@
+/* Terminal ScreenSaver - video wall
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * Curses only drives one terminal at a time, and not from several
+ * threads, so the other ttys of the wall don't go through it. Each frame
+ * of a slice becomes one buffer of cursor moves, colors and characters,
+ * sent with a single write() by the tty's own output thread.
+ *
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+
+#include "wall.h"
+#include "color.h"
+#include "compose.h"
+#include "utf8.h"
+
+#define CELL_BYTES		32	/* Cursor move, color and a character */
+#define STALL_CHECK		100	/* ms between looks at w->closing */
+#define GRACE			500	/* ms a tty gets to take the rest when closing */
+
+static const char tty_start[] = "\033[0m\033[?25l\033[H\033[2J";
+static const char tty_end[]   = "\033[0m\033[H\033[2J\033[?25h";
+
+/* Blocks while the tty is slow, but not past wall_free(): a tty nobody
+ * reads (or one stopped with ^S) would keep tss from ever quitting */
+static void write_all(struct wallTtyEx *t, const char *data, long length){
+  struct pollfd out;
+  long n;
+
+  while(length > 0 && !t->broken){
+    n = write(t->fd, data, length);
+    if(n < 0 && errno == EINTR)
+      continue;
+    if(n < 0 && errno == EAGAIN){
+      out.fd = t->fd;
+      out.events = POLLOUT;
+      if(__atomic_load_n(&t->wall->closing, __ATOMIC_ACQUIRE)){
+        if(poll(&out, 1, GRACE) == 0)
+          break;
+      }else{
+        poll(&out, 1, STALL_CHECK);
+      }
+      continue;
+    }
+    if(n <= 0){
+      t->broken = 1;		/* Unplugged; the others go on */
+      break;
+    }
+    data += n;
+    length -= n;
+  }
+}
+
+/* Bold, as on this terminal, in the classic colors nearest [color] */
+static char *set_color(struct wallEx *w, char *o, int color){
+  struct paletteEx *p;
+  int fg, bg;
+
+  if(color == 0)
+    return o + sprintf(o, "\033[0;1m");
+
+  if(color <= ART_LEGACY_COLORS || w->palette == NULL){
+    fg = (color - 1) & 7;
+    bg = 0;
+  }else{
+    p = &w->palette[color];
+    fg = color_basic(p->fg);
+    bg = color_basic(p->bg);
+  }
+  return o + sprintf(o, "\033[0;1;%d;%dm", 30 + fg, 40 + bg);
+}
+
+static char *put_cell(struct wallEx *w, char *o, struct cellEx *cell){
+  if(cell->ch < 0x80){
+    *o++ = cell->ch;
+  }else if(w->utf8){
+    o += utf8_encode(cell->ch, o);
+  }else{
+    *o++ = cell->ch < 0x100 ? cell->ch : '?';
+    if(cell->width == 2)
+      *o++ = '?';
+  }
+  return o;
+}
+
+/* The output thread of a tty */
+static void draw_tty(void *context, struct cellEx *cells, struct cellEx *front,
+                     int width, int height){
+  struct wallTtyEx *t = context;
+  char *o;
+  int at_x, at_y;
+  int color;
+  int x, y;
+
+  o = t->out;
+  at_x = -1;
+  at_y = -1;
+  color = -1;
+
+  for(y = 0; y < height; y++)
+    for(x = 0; x < width; x++, cells++, front++){
+      if(cells->ch == front->ch && cells->color == front->color &&
+         cells->width == front->width)
+        continue;
+      *front = *cells;
+      if(cells->width == 0)
+        continue;
+      if(x != at_x || y != at_y)
+        o += sprintf(o, "\033[%d;%dH", y + 1, x + 1);
+      if(cells->color != color){
+        color = cells->color;
+        o = set_color(t->wall, o, color);
+      }
+      o = put_cell(t->wall, o, cells);
+      at_x = x + cells->width;
+      at_y = y;
+    }
+
+  if(o != t->out)
+    write_all(t, t->out, o - t->out);
+}
+
+static int open_tty(struct wallTtyEx *t, char *error){
+  struct winsize size;
+
+  t->fd = open(t->name, O_WRONLY | O_NOCTTY | O_NONBLOCK);
+  if(t->fd < 0){
+    sprintf(error, "\"%.512s\" could not be opened: %s\n", t->name, strerror(errno));
+    return -1;
+  }
+  if(!isatty(t->fd) || ioctl(t->fd, TIOCGWINSZ, &size) < 0 ||
+     size.ws_col == 0 || size.ws_row == 0){
+    sprintf(error, "\"%.512s\" is not a terminal I can tell the size of.\n", t->name);
+    return -1;
+  }
+
+  t->width	= size.ws_col;
+  t->height	= size.ws_row;
+  return 0;
+}
+
+/* [ttys] is a comma separated list of tty devices */
+struct wallEx *wall_new(const char *ttys, int home_width, int home_height,
+                        int utf8, char *error){
+  struct wallEx *w;
+  struct wallTtyEx *t;
+  const char *from;
+  const char *to;
+  long cells;
+  int i;
+
+  w = calloc(1, sizeof(struct wallEx));
+  if(w == NULL){
+    sprintf(error, "Out of memory.\n");
+    return NULL;
+  }
+  w->utf8	= utf8;
+  w->home_width	= home_width;
+  w->width	= home_width;
+  w->height	= home_height;
+  for(i = 0; i < WALL_MAX; i++)
+    w->tty[i].fd = -1;
+
+  for(from = ttys; *from != 0; from = *to ? to + 1 : to){
+    to = strchr(from, ',');
+    if(to == NULL)
+      to = from + strlen(from);
+    if(to == from)
+      continue;
+    if(w->count == WALL_MAX){
+      sprintf(error, "A wall can have at most %d more terminals.\n", WALL_MAX);
+      wall_free(w);
+      return NULL;
+    }
+
+    t = &w->tty[w->count++];
+    t->wall = w;
+    t->name = malloc(to - from + 1);
+    if(t->name == NULL){
+      sprintf(error, "Out of memory.\n");
+      wall_free(w);
+      return NULL;
+    }
+    memcpy(t->name, from, to - from);
+    t->name[to - from] = 0;
+
+    if(open_tty(t, error) == -1){
+      wall_free(w);
+      return NULL;
+    }
+    t->x = w->width;
+    w->width += t->width;
+    if(t->height < w->height)
+      w->height = t->height;
+  }
+
+  if(w->count == 0){
+    sprintf(error, "--wall needs at least one tty.\n");
+    wall_free(w);
+    return NULL;
+  }
+
+  /* All sizes are known now; the canvas is as high as the lowest */
+  cells = (long)home_width * w->height;
+  w->home	= malloc(cells * sizeof(struct cellEx));
+  w->home_front	= malloc(cells * sizeof(struct cellEx));
+  if(w->home == NULL || w->home_front == NULL){
+    sprintf(error, "Out of memory.\n");
+    wall_free(w);
+    return NULL;
+  }
+  wall_forget(w);
+
+  for(i = 0; i < w->count; i++){
+    t = &w->tty[i];
+    cells = (long)t->width * w->height;
+    t->slice	= malloc(cells * sizeof(struct cellEx));
+    t->out	= malloc(cells * CELL_BYTES);
+    if(t->slice == NULL || t->out == NULL){
+      sprintf(error, "Out of memory.\n");
+      wall_free(w);
+      return NULL;
+    }
+
+    write_all(t, tty_start, sizeof(tty_start) - 1);
+    t->render = render_new(t->width, w->height, draw_tty, t);
+    if(t->render == NULL){
+      sprintf(error, "Could not start the output thread for \"%.512s\".\n", t->name);
+      wall_free(w);
+      return NULL;
+    }
+  }
+
+  return w;
+}
+
+void wall_free(struct wallEx *w){
+  struct wallTtyEx *t;
+  int i;
+
+  if(w == NULL)
+    return;
+
+  __atomic_store_n(&w->closing, 1, __ATOMIC_RELEASE);
+  for(i = 0; i < w->count; i++){
+    t = &w->tty[i];
+    if(t->render != NULL){
+      render_free(t->render);	/* Lets the last frame out first */
+      write_all(t, tty_end, sizeof(tty_end) - 1);
+    }
+    if(t->fd != -1)
+      close(t->fd);
+    free(t->out);
+    free(t->slice);
+    free(t->name);
+  }
+
+  free(w->home);
+  free(w->home_front);
+  free(w);
+}
+
+static void copy_slice(struct cellEx *to, struct cellEx *canvas, int canvas_width,
+                       int x, int width, int height){
+  int y;
+
+  for(y = 0; y < height; y++)
+    memcpy(to + (long)y * width, canvas + (long)y * canvas_width + x,
+           width * sizeof(struct cellEx));
+}
+
+/* Hand every other tty its slice of [canvas], and put this terminal's in
+ * w->home. Returns how many ttys were still busy with the last frame. */
+int wall_publish(struct wallEx *w, struct cellEx *canvas){
+  struct wallTtyEx *t;
+  int dropped;
+  int i;
+
+  dropped = 0;
+  for(i = 0; i < w->count; i++){
+    t = &w->tty[i];
+    copy_slice(t->slice, canvas, w->width, t->x, t->width, w->height);
+    dropped += render_publish(t->render, t->slice);
+  }
+
+  copy_slice(w->home, canvas, w->width, 0, w->home_width, w->height);
+  return dropped;
+}
+
+/* Keeps the other ttys' output threads between frames */
+void wall_pause(struct wallEx *w){
+  int i;
+
+  for(i = 0; i < w->count; i++)
+    render_pause(w->tty[i].render);
+}
+
+void wall_resume(struct wallEx *w){
+  int i;
+
+  for(i = 0; i < w->count; i++)
+    render_resume(w->tty[i].render);
+}
+
+/* While paused: the ascii changed, and with it what the palette indices
+ * mean */
+void wall_palette(struct wallEx *w, struct paletteEx *palette){
+  int i;
+
+  w->palette = palette;
+  for(i = 0; i < w->count; i++)
+    render_invalidate(w->tty[i].render);
+  wall_forget(w);
+}
+
+/* This terminal was cleared; its whole slice is drawn again */
+void wall_forget(struct wallEx *w){
+  long i;
+
+  for(i = 0; i < (long)w->home_width * w->height; i++)
+    w->home_front[i].ch = COMPOSE_UNKNOWN;
+}
@@ -0,0 +1,64 @@
+/* Terminal ScreenSaver - video wall
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * --wall spreads the screen saver over more terminals. The one tss runs
+ * on is the left end, the ttys given follow to the right in that order;
+ * everything moves about one canvas as wide as all of them together and
+ * as high as the lowest. Each terminal is sent only its own slice. The
+ * other ttys are written by an output thread each (see render.h), so a
+ * slow one shows fewer frames of the same clock and holds nobody else
+ * up. They are sent plain escape sequences in the eight classic colors.
+ */
+
+#ifndef TSS_WALL_H
+#define TSS_WALL_H
+
+#include "art.h"
+#include "render.h"
+
+#define WALL_MAX		8
+#define WALL_ERROR_SIZE		600
+
+struct wallEx;
+
+struct wallTtyEx{
+  char *name;
+  int fd;
+  int x;			/* Left edge on the canvas */
+  int width;
+  int height;			/* Of the tty, at least the canvas' */
+  int broken;			/* A write failed; output thread only */
+  struct cellEx *slice;
+  char *out;			/* Escape sequences for one frame */
+  struct renderEx *render;
+  struct wallEx *wall;
+};
+
+struct wallEx{
+  int width;			/* The canvas */
+  int height;
+  int home_width;		/* This terminal's slice is the leftmost */
+  struct cellEx *home;
+  struct cellEx *home_front;
+  int utf8;
+  int closing;			/* Atomic; ttys stop waiting to be written */
+  struct paletteEx *palette;	/* Of the ascii; changed with all paused */
+  int count;
+  struct wallTtyEx tty[WALL_MAX];
+};
+
+struct wallEx *wall_new(const char *ttys, int home_width, int home_height,
+                        int utf8, char *error);
+void wall_free(struct wallEx *w);
+int wall_publish(struct wallEx *w, struct cellEx *canvas);
+void wall_pause(struct wallEx *w);
+void wall_resume(struct wallEx *w);
+void wall_palette(struct wallEx *w, struct paletteEx *palette);
+void wall_forget(struct wallEx *w);
+
+#endif
@@ -0,0 +1,56 @@
+/* Terminal ScreenSaver - idle watcher
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ ***
+ *
+ * Linux only moves a tty's access time when it is at least 8 seconds old,
+ * so that it can't be used to time keystrokes. Idle times are therefore
+ * up to 8 seconds long, never short. Its modification time is the last
+ * output, kept the same way.
+ *
+ * */
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "watch.h"
+
+/* Returns once nothing was read from the terminal [fd] for [idle] seconds,
+ * and with [output] nothing written to it either; -1 if [fd] can't tell */
+int watch_idle(int fd, long idle, int output){
+  struct stat tty;
+  time_t last;
+  long left;
+
+  for(;;){
+    if(fstat(fd, &tty) == -1)
+      return -1;
+
+    last = tty.st_atime;
+    if(output && tty.st_mtime > last)
+      last = tty.st_mtime;
+    left = (long)(last + idle - time(NULL));
+    if(left <= 0)
+      return 0;
+
+    /* Input in the meantime moved the access time on; look again then */
+    while(left > 0)
+      left = sleep(left);
+  }
+}
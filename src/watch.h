@@ -0,0 +1,24 @@
+/* Terminal ScreenSaver - idle watcher
+ * Copyright (C) 2006 Kristian "gamkiller" Gunstone
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * With --watch, tss starts itself: it waits until nothing was typed on
+ * its terminal for a while, runs, and goes back to waiting once a key
+ * (or the password) ends it. The kernel notes the time of the last input
+ * on a tty as the device's access time, which is what w(1) shows as idle
+ * time too; tss only looks at it when the wait it worked out from the
+ * last one runs out, so waiting costs nothing. A job that reads nothing
+ * but keeps writing, such as a build, is not idle: for that the time of
+ * the last output (the modification time) has to be old as well.
+ */
+
+#ifndef TSS_WATCH_H
+#define TSS_WATCH_H
+
+int watch_idle(int fd, long idle, int output);
+
+#endif